@@ -0,0 +1,43 @@
+# writes a C++ include holding every SPIR-V binary as a constexpr uint32_t array
+# run with -DOUTPUT=file -DSHADERS=name=path|name=path, names are the paths shaders are looked up by at runtime
+
+string(REPLACE "|" ";" SHADER_LIST "${SHADERS}")
+set(ARRAYS "")
+set(ENTRIES "")
+set(INDEX 0)
+foreach(SHADER ${SHADER_LIST})
+	string(FIND "${SHADER}" "=" SPLIT)
+	string(SUBSTRING "${SHADER}" 0 ${SPLIT} NAME)
+	math(EXPR SPLIT "${SPLIT} + 1")
+	string(SUBSTRING "${SHADER}" ${SPLIT} -1 PATH)
+	if(NOT EXISTS "${PATH}")
+		continue()
+	endif()
+
+	file(READ "${PATH}" HEX HEX)
+	string(LENGTH "${HEX}" HEX_LENGTH)
+	math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+	if(NOT REMAINDER EQUAL 0)
+		message(FATAL_ERROR "${PATH} isn't a whole number of SPIR-V words")
+	endif()
+	# SPIR-V is a stream of little endian words
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," WORDS "${HEX}")
+	# eight words to a line, cmake regexes have no repetition counts
+	string(REPEAT "0x[0-9a-f]+," 8 LINE)
+	string(REGEX REPLACE "(${LINE})" "\\1\n\t" WORDS "${WORDS}")
+	string(STRIP "${WORDS}" WORDS)
+	string(APPEND ARRAYS "// ${NAME}\nconstexpr uint32_t shader${INDEX}[] = {\n\t${WORDS}\n};\n\n")
+	string(APPEND ENTRIES "\t{ \"${NAME}\", shader${INDEX}, sizeof(shader${INDEX}) },\n")
+	math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENT "// generated by cmake/EmbedShaders.cmake from the compiled shaders, do not edit\n\n${ARRAYS}")
+string(APPEND CONTENT "static const ShaderBinary embeddedShaders[] = {\n${ENTRIES}\t{ nullptr, nullptr, 0 }\n};\n")
+# leave the file untouched when nothing changed, so dependents aren't rebuilt
+if(EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" PREVIOUS)
+	if(PREVIOUS STREQUAL CONTENT)
+		return()
+	endif()
+endif()
+file(WRITE "${OUTPUT}" "${CONTENT}")
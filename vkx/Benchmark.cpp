@@ -0,0 +1,367 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+// nearest-rank percentile of an ascending list
+static double percentile(const std::vector<double>& sorted, double fraction) {
+	size_t rank = (size_t)std::ceil(fraction * sorted.size());
+	return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+static double mean(const std::vector<double>& values) {
+	double total = 0;
+	for (double value : values)
+		total += value;
+	return total / values.size();
+}
+
+// the contents of a json string, quotes, backslashes and control characters escaped
+static std::string jsonString(const std::string& text) {
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+			escaped += code;
+		}
+		else
+			escaped += c;
+	}
+	return escaped;
+}
+
+// a window that doesn't pump its events is reported unresponsive and never sees resizes,
+// closing it abandons the run rather than reporting the frames measured so far
+static void pollWindow(Renderer& renderer) {
+	if (renderer.settings.headless)
+		return;
+	glfwPollEvents();
+	if (renderer.shouldClose())
+		throw std::runtime_error("benchmark window was closed");
+}
+
+BenchmarkResult Benchmark::runScene(const RenderSettings& settings) {
+	using clock = std::chrono::steady_clock;
+	if (measuredFrames == 0)
+		throw std::runtime_error("failed to run benchmark, it needs at least one measured frame");
+	Renderer renderer(settings);
+
+	BenchmarkResult result;
+	// as the renderer applied them, some options imply others
+	result.settings = renderer.settings;
+	result.frames = measuredFrames;
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	result.device = props.deviceName;
+
+	// the scene's pipeline is built in the background, frames before it's ready would measure the default one
+	renderer.compiler->wait();
+	for (uint64_t i = 0; i < warmupFrames; i++) {
+		pollWindow(renderer);
+		renderer.drawFrame();
+	}
+	vkDeviceWaitIdle(renderer.device);
+
+	std::vector<double> frameTimes;
+	std::vector<double> gpuFrameTimes;
+	frameTimes.reserve(measuredFrames);
+	double waitedMs = renderer.scheduler.totalWaitMs;
+	double culledMs = renderer.scene->totalCullMs;
+	double transformedMs = renderer.transforms != nullptr ? renderer.transforms->totalUpdateMs : 0.0;
+	auto start = clock::now();
+	for (uint64_t i = 0; i < measuredFrames; i++) {
+		pollWindow(renderer);
+		auto frameStart = clock::now();
+		uint64_t collected = renderer.profiler.collectedFrames;
+		renderer.drawFrame();
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(clock::now() - frameStart).count());
+		// timestamps arrive a few frames late, once the gate that rendered them comes around again
+		if (renderer.profiler.collectedFrames != collected)
+			gpuFrameTimes.push_back(renderer.profiler.lastFrameMs);
+	}
+	vkDeviceWaitIdle(renderer.device);
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+	result.waitMs = (renderer.scheduler.totalWaitMs - waitedMs) / measuredFrames;
+	result.cullMs = (renderer.scene->totalCullMs - culledMs) / measuredFrames;
+	result.cullKernel = cullKernelName(renderer.scene->kernel);
+	// the gpu's survivors are never read back, the cpu's test of the same frustum counts the same ones
+	if (renderer.settings.gpuCulling)
+		renderer.scene->cull();
+	result.objects = renderer.scene->objectCount();
+	result.visibleObjects = renderer.scene->visibleCount;
+	if (renderer.transforms != nullptr) {
+		result.transformMs = (renderer.transforms->totalUpdateMs - transformedMs) / measuredFrames;
+		result.updatedNodes = renderer.transforms->updatedNodes;
+	}
+	result.timeline = renderer.scheduler.timeline;
+	result.memory = renderer.allocator->stats();
+	result.startupMs = renderer.startup.totalMs();
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	result.meanMs = mean(frameTimes);
+	result.p50Ms = percentile(frameTimes, 0.50);
+	result.p99Ms = percentile(frameTimes, 0.99);
+	result.maxMs = frameTimes.back();
+	if (!gpuFrameTimes.empty()) {
+		std::sort(gpuFrameTimes.begin(), gpuFrameTimes.end());
+		result.gpuFrames = gpuFrameTimes.size();
+		result.gpuMeanMs = mean(gpuFrameTimes);
+		result.gpuP50Ms = percentile(gpuFrameTimes, 0.50);
+		result.gpuP99Ms = percentile(gpuFrameTimes, 0.99);
+		result.gpuMaxMs = gpuFrameTimes.back();
+	}
+	result.framesPerSecond = measuredFrames / seconds;
+	results.push_back(result);
+	return result;
+}
+
+void Benchmark::writeJson(const std::string& path) {
+	std::ofstream file(path);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open file " + path);
+
+	file << "{\n\t\"label\": \"" << jsonString(label) << "\",\n\t\"scenes\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+		file << (i == 0 ? "\n" : ",\n");
+		file << "\t\t{\n";
+		file << "\t\t\t\"device\": \"" << jsonString(result.device) << "\",\n";
+		file << "\t\t\t\"headless\": " << (result.settings.headless ? "true" : "false") << ",\n";
+		file << "\t\t\t\"width\": " << result.settings.width << ",\n";
+		file << "\t\t\t\"height\": " << result.settings.height << ",\n";
+		file << "\t\t\t\"triangles\": " << result.settings.triangleCount << ",\n";
+		file << "\t\t\t\"draws\": " << result.settings.drawCount << ",\n";
+		file << "\t\t\t\"framesInFlight\": " << result.settings.framesInFlight << ",\n";
+		file << "\t\t\t\"recordEachFrame\": " << (result.settings.recordEachFrame ? "true" : "false") << ",\n";
+		file << "\t\t\t\"recordThreads\": " << result.settings.recordThreads << ",\n";
+		file << "\t\t\t\"msaaSamples\": " << result.settings.msaaSamples << ",\n";
+		file << "\t\t\t\"depthPrepass\": " << (result.settings.depthPrepass ? "true" : "false") << ",\n";
+		file << "\t\t\t\"gpuCulling\": " << (result.settings.gpuCulling ? "true" : "false") << ",\n";
+		file << "\t\t\t\"cpuCulling\": " << (result.settings.cpuCulling ? "true" : "false") << ",\n";
+		file << "\t\t\t\"cullThreads\": " << result.settings.cullThreads << ",\n";
+		file << "\t\t\t\"visibleFraction\": " << result.settings.visibleFraction << ",\n";
+		file << "\t\t\t\"cullKernel\": \"" << result.cullKernel << "\",\n";
+		file << "\t\t\t\"transformFanout\": " << result.settings.transformFanout << ",\n";
+		file << "\t\t\t\"animatedNodes\": " << result.settings.animatedNodes << ",\n";
+		file << "\t\t\t\"transformThreads\": " << result.settings.transformThreads << ",\n";
+		file << "\t\t\t\"asyncCompute\": " << (result.settings.asyncCompute ? "true" : "false") << ",\n";
+		file << "\t\t\t\"drawData\": \"" << drawDataName(result.settings.drawData) << "\",\n";
+		file << "\t\t\t\"presentPolicy\": \"" << presentPolicyName(result.settings.presentPolicy) << "\",\n";
+		file << "\t\t\t\"bindless\": " << (result.settings.bindless ? "true" : "false") << ",\n";
+		file << "\t\t\t\"frames\": " << result.frames << ",\n";
+		file << "\t\t\t\"cpuFrameMs\": { \"mean\": " << result.meanMs << ", \"p50\": " << result.p50Ms
+			<< ", \"p99\": " << result.p99Ms << ", \"max\": " << result.maxMs << " },\n";
+		file << "\t\t\t\"timeline\": " << (result.timeline ? "true" : "false") << ",\n";
+		file << "\t\t\t\"cpuWaitMs\": " << result.waitMs << ",\n";
+		file << "\t\t\t\"cpuCullMs\": " << result.cullMs << ",\n";
+		file << "\t\t\t\"objects\": " << result.objects << ",\n";
+		file << "\t\t\t\"visibleObjects\": " << result.visibleObjects << ",\n";
+		file << "\t\t\t\"transformMs\": " << result.transformMs << ",\n";
+		file << "\t\t\t\"updatedNodes\": " << result.updatedNodes << ",\n";
+		file << "\t\t\t\"memory\": { \"blocks\": " << result.memory.blockCount << ", \"dedicated\": " << result.memory.dedicatedCount
+			<< ", \"allocations\": " << result.memory.allocationCount << ", \"reservedBytes\": " << result.memory.reservedBytes
+			<< ", \"usedBytes\": " << result.memory.usedBytes << ", \"lazyBytes\": " << result.memory.lazyBytes << ", \"fragmentation\": " << result.memory.fragmentation << " },\n";
+		file << "\t\t\t\"gpuFrames\": " << result.gpuFrames << ",\n";
+		file << "\t\t\t\"gpuFrameMs\": { \"mean\": " << result.gpuMeanMs << ", \"p50\": " << result.gpuP50Ms
+			<< ", \"p99\": " << result.gpuP99Ms << ", \"max\": " << result.gpuMaxMs << " },\n";
+		file << "\t\t\t\"startupMs\": " << result.startupMs << ",\n";
+		file << "\t\t\t\"fps\": " << result.framesPerSecond << "\n";
+		file << "\t\t}";
+	}
+	file << "\n\t]\n}\n";
+}
+
+// parses a comma separated list such as 1,1000,1000000, false leaves values untouched when an item is below minimum
+// throws std::invalid_argument or std::out_of_range for items that aren't numbers
+static bool parseList(const std::string& arg, std::vector<uint32_t>& values, uint32_t minimum) {
+	std::vector<uint32_t> parsed;
+	std::stringstream stream(arg);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		parsed.push_back((uint32_t)std::stoul(item));
+		if (parsed.back() < minimum)
+			return false;
+	}
+	if (parsed.empty())
+		return false;
+	values = parsed;
+	return true;
+}
+
+// false leaves fraction untouched unless it is above 0 and at most 1, throws as std::stof does
+static bool parseFraction(const std::string& arg, float& fraction) {
+	float parsed = std::stof(arg);
+	if (parsed <= 0.0f || parsed > 1.0f)
+		return false;
+	fraction = parsed;
+	return true;
+}
+
+static void printUsage() {
+	std::cerr << "usage: vkx_bench [--frames n] [--warmup n] [--out file] [--label text]"
+		" [--triangles a,b] [--draws a,b] [--frames-in-flight a,b] [--record-threads a,b] [--window] [--no-timeline] [--static-commands] [--msaa n] [--depth-prepass] [--gpu-culling] [--cpu-culling] [--cull-threads n] [--visible-fraction f]"
+		" [--transform-fanout n] [--animated-nodes n] [--transform-threads n] [--async-compute] [--bindless]"
+		" [--draw-data none|uniform|push] [--present low-latency|throughput|power-saving]\n";
+}
+
+int main(int argc, char** argv) {
+	Benchmark benchmark;
+	std::string outPath = "bench.json";
+	bool headless = true;
+	bool timeline = true;
+	bool recordEachFrame = true;
+	uint32_t msaaSamples = 1;
+	bool depthPrepass = false;
+	bool gpuCulling = false;
+	bool cpuCulling = false;
+	uint32_t cullThreads = 4;
+	float visibleFraction = 1.0f;
+	uint32_t transformFanout = 0;
+	uint32_t animatedNodes = 0;
+	uint32_t transformThreads = 4;
+	bool asyncCompute = false;
+	bool bindless = false;
+	DrawData drawData = DrawData::None;
+	PresentPolicy presentPolicy = PresentPolicy::Throughput;
+	std::vector<uint32_t> triangleCounts = { 1, 1000, 100000, 1000000 };
+	std::vector<uint32_t> drawCounts = { 1, 100, 10000, 100000 };
+	std::vector<uint32_t> framesInFlight = { 1, 2, 3 };
+	std::vector<uint32_t> recordThreads = { 0 };
+
+	// numbers are read with std::stoul, which throws std::invalid_argument or std::out_of_range on bad input
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			// statistics need at least one measured frame
+			if (arg == "--frames" && hasValue && std::stoull(argv[i + 1]) > 0)
+				benchmark.measuredFrames = std::stoull(argv[++i]);
+			else if (arg == "--warmup" && hasValue)
+				benchmark.warmupFrames = std::stoull(argv[++i]);
+			else if (arg == "--out" && hasValue)
+				outPath = argv[++i];
+			else if (arg == "--label" && hasValue)
+				benchmark.label = argv[++i];
+			// a scene needs a triangle, a draw and a frame in flight, recording can stay on the one thread
+			else if (arg == "--triangles" && hasValue && parseList(argv[i + 1], triangleCounts, 1))
+				i++;
+			else if (arg == "--draws" && hasValue && parseList(argv[i + 1], drawCounts, 1))
+				i++;
+			else if (arg == "--frames-in-flight" && hasValue && parseList(argv[i + 1], framesInFlight, 1))
+				i++;
+			else if (arg == "--record-threads" && hasValue && parseList(argv[i + 1], recordThreads, 0))
+				i++;
+			else if (arg == "--window")
+				headless = false;
+			else if (arg == "--no-timeline")
+				timeline = false;
+			else if (arg == "--static-commands")
+				recordEachFrame = false;
+			else if (arg == "--msaa" && hasValue)
+				msaaSamples = (uint32_t)std::stoul(argv[++i]);
+			else if (arg == "--depth-prepass")
+				depthPrepass = true;
+			else if (arg == "--gpu-culling")
+				gpuCulling = true;
+			else if (arg == "--cpu-culling")
+				cpuCulling = true;
+			else if (arg == "--cull-threads" && hasValue)
+				cullThreads = (uint32_t)std::stoul(argv[++i]);
+			else if (arg == "--visible-fraction" && hasValue && parseFraction(argv[i + 1], visibleFraction))
+				i++;
+			else if (arg == "--transform-fanout" && hasValue)
+				transformFanout = (uint32_t)std::stoul(argv[++i]);
+			else if (arg == "--animated-nodes" && hasValue)
+				animatedNodes = (uint32_t)std::stoul(argv[++i]);
+			else if (arg == "--transform-threads" && hasValue)
+				transformThreads = (uint32_t)std::stoul(argv[++i]);
+			else if (arg == "--async-compute")
+				asyncCompute = true;
+			else if (arg == "--bindless")
+				bindless = true;
+			else if (arg == "--draw-data" && hasValue && parseDrawData(argv[i + 1], drawData))
+				i++;
+			else if (arg == "--present" && hasValue && parsePresentPolicy(argv[i + 1], presentPolicy))
+				i++;
+			else {
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	catch (const std::logic_error&) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	try {
+		for (uint32_t triangles : triangleCounts) {
+			for (uint32_t draws : drawCounts) {
+				// a draw call always carries at least one triangle
+				if (draws > triangles)
+					continue;
+				for (uint32_t inFlight : framesInFlight) {
+					for (uint32_t threads : recordThreads) {
+						RenderSettings settings;
+						settings.headless = headless;
+						settings.triangleCount = triangles;
+						settings.drawCount = draws;
+						settings.framesInFlight = inFlight;
+						settings.recordThreads = threads;
+						settings.timelineSemaphores = timeline;
+						settings.recordEachFrame = recordEachFrame;
+						settings.msaaSamples = msaaSamples;
+						settings.depthPrepass = depthPrepass;
+						settings.gpuCulling = gpuCulling;
+						settings.cpuCulling = cpuCulling;
+						settings.cullThreads = cullThreads;
+						settings.visibleFraction = visibleFraction;
+						settings.transformFanout = transformFanout;
+						settings.animatedNodes = animatedNodes;
+						settings.transformThreads = transformThreads;
+						settings.asyncCompute = asyncCompute;
+						settings.bindless = bindless;
+						settings.drawData = drawData;
+						settings.presentPolicy = presentPolicy;
+						// swapped by the renderer for a shader reading the draw data or the hierarchy when there is one
+						settings.vertexShaderPath = "shaders/bench.spv";
+						// the time to the first frame goes in the report instead
+						settings.startupReport = false;
+
+						BenchmarkResult result = benchmark.runScene(settings);
+						std::cout << triangles << " triangles, " << draws << " draws, " << inFlight << " in flight, "
+							<< threads << " record threads: " << result.meanMs << "ms mean, " << result.p99Ms << "ms p99, "
+							<< result.gpuMeanMs << "ms gpu mean, " << result.framesPerSecond << " fps";
+						if (result.settings.cpuCulling)
+							std::cout << ", " << result.cullMs << "ms " << result.cullKernel << " cull";
+						if (result.settings.cpuCulling || result.settings.gpuCulling)
+							std::cout << ", " << result.visibleObjects << "/" << result.objects << " visible";
+						if (result.settings.transformFanout > 0)
+							std::cout << ", " << result.transformMs << "ms transforms";
+						std::cout << "\n";
+					}
+				}
+			}
+		}
+		benchmark.writeJson(outPath);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
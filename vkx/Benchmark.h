@@ -0,0 +1,60 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <string>
+#include <vector>
+
+#include "RenderSettings.h"
+#include "MemoryAllocator.h"
+
+// frame timings of one scene, rendered for a fixed number of frames
+class BenchmarkResult {
+public:
+	RenderSettings settings;
+	std::string device;
+	uint64_t frames = 0;
+	// cpu time spent inside drawFrame, in milliseconds
+	double meanMs = 0;
+	double p50Ms = 0;
+	double p99Ms = 0;
+	double maxMs = 0;
+	// gpu time from the first to the last timestamp of each frame, zero when timestamps are unsupported
+	uint64_t gpuFrames = 0;
+	double gpuMeanMs = 0;
+	double gpuP50Ms = 0;
+	double gpuP99Ms = 0;
+	double gpuMaxMs = 0;
+	// mean cpu time per frame spent blocked on the gpu, and whether a timeline semaphore paced the frames
+	double waitMs = 0;
+	bool timeline = false;
+	// device memory held by the renderer's allocator at the end of the scene
+	MemoryStats memory;
+	// measured over wall time, including the wait for the gpu to drain
+	double framesPerSecond = 0;
+	// from creating the renderer to its first frame, which waits for the scene's pipeline
+	double startupMs = 0;
+	// mean cpu time per frame spent culling, and the kernel that did it
+	double cullMs = 0;
+	std::string cullKernel;
+	// objects left after culling, every object when nothing culls
+	uint32_t objects = 0;
+	uint32_t visibleObjects = 0;
+	// mean cpu time per frame spent updating the transform hierarchy, and the nodes recomputed in its last frame
+	double transformMs = 0;
+	uint32_t updatedNodes = 0;
+};
+
+class Benchmark {
+public:
+	// frames rendered before timing starts, so pipelines and caches are warm
+	uint64_t warmupFrames = 16;
+	uint64_t measuredFrames = 300;
+	// free-form tag written to the report, such as the commit being measured
+	std::string label;
+	std::vector<BenchmarkResult> results;
+
+	BenchmarkResult runScene(const RenderSettings& settings);
+	void writeJson(const std::string& path);
+};
+
+#endif
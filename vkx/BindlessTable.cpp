@@ -0,0 +1,147 @@
+#include "BindlessTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+BindlessTable::BindlessTable(Renderer& renderer, uint32_t textureCount, uint32_t bufferCount) {
+	device = renderer.device;
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT limits{};
+	limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	renderer.queryProperties(renderer.physicalDevice, &limits);
+	textureCapacity = std::max(1u, std::min({ textureCount, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+		limits.maxPerStageDescriptorUpdateAfterBindSampledImages }));
+	bufferCapacity = std::max(1u, std::min({ bufferCount, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+		limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers }));
+	textures.capacity = textureCapacity;
+	buffers.capacity = bufferCapacity;
+
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[TEXTURE_BINDING].binding = TEXTURE_BINDING;
+	bindings[TEXTURE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[TEXTURE_BINDING].descriptorCount = textureCapacity;
+	bindings[TEXTURE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[BUFFER_BINDING].binding = BUFFER_BINDING;
+	bindings[BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[BUFFER_BINDING].descriptorCount = bufferCapacity;
+	bindings[BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+	// unwritten elements are fine as long as shaders don't read them
+	VkDescriptorBindingFlagsEXT bindingFlags[2] = {
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT,
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+	};
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flagsInfo.bindingCount = 2;
+	flagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create bindless descriptor set layout");
+
+	VkDescriptorPoolSize poolSizes[2] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureCapacity },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferCapacity }
+	};
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create bindless descriptor pool");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+	if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate bindless descriptor set");
+}
+
+uint32_t BindlessTable::addTexture(VkImageView view, VkSampler sampler, VkImageLayout imageLayout) {
+	std::lock_guard<std::mutex> guard(lock);
+	uint32_t index = textures.take();
+	VkDescriptorImageInfo imageInfo{ sampler, view, imageLayout };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = TEXTURE_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return index;
+}
+
+uint32_t BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	std::lock_guard<std::mutex> guard(lock);
+	uint32_t index = buffers.take();
+	VkDescriptorBufferInfo bufferInfo{ buffer, offset, range };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = BUFFER_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::releaseTexture(uint32_t index, uint64_t retiredFrame) {
+	std::lock_guard<std::mutex> guard(lock);
+	textures.retired.push_back(std::make_pair(retiredFrame, index));
+}
+
+void BindlessTable::releaseBuffer(uint32_t index, uint64_t retiredFrame) {
+	std::lock_guard<std::mutex> guard(lock);
+	buffers.retired.push_back(std::make_pair(retiredFrame, index));
+}
+
+void BindlessTable::collect(uint64_t completedFrames) {
+	std::lock_guard<std::mutex> guard(lock);
+	textures.collect(completedFrames);
+	buffers.collect(completedFrames);
+}
+
+void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkPipelineBindPoint bindPoint, uint32_t setIndex) {
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &set, 0, nullptr);
+}
+
+void BindlessTable::clean() {
+	// destroying the pool frees the set
+	vkDestroyDescriptorPool(device, pool, nullptr);
+	vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+uint32_t BindlessTable::Slots::take() {
+	if (!free.empty()) {
+		uint32_t index = free.back();
+		free.pop_back();
+		return index;
+	}
+	if (next == capacity)
+		throw std::runtime_error("bindless descriptor array is full");
+	return next++;
+}
+
+void BindlessTable::Slots::collect(uint64_t completedFrames) {
+	// released in frame order, so the oldest are at the front
+	while (!retired.empty() && completedFrames >= retired.front().first) {
+		free.push_back(retired.front().second);
+		retired.pop_front();
+	}
+}
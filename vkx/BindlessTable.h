@@ -0,0 +1,66 @@
+#ifndef BindlessTable_h
+#define BindlessTable_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class Renderer;
+
+// one descriptor set holding every texture and storage buffer the scene uses, shaders index into its arrays
+// it is bound once per command buffer rather than a set per draw, and written with update-after-bind
+// so resources can be added while frames that use the set are still in flight
+// needs VK_EXT_descriptor_indexing
+class BindlessTable {
+public:
+	static const uint32_t TEXTURE_BINDING = 0;
+	static const uint32_t BUFFER_BINDING = 1;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// array sizes, clamped to the device's update-after-bind limits
+	uint32_t textureCapacity = 0;
+	uint32_t bufferCapacity = 0;
+
+	BindlessTable(Renderer& renderer, uint32_t textureCount, uint32_t bufferCount);
+	BindlessTable(const BindlessTable&) = delete;
+	BindlessTable& operator=(const BindlessTable&) = delete;
+	// return the array index shaders read the resource at, safe to call from any thread
+	uint32_t addTexture(VkImageView view, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	// frames before retiredFrame may still read the index, it is handed out again once they have finished
+	void releaseTexture(uint32_t index, uint64_t retiredFrame);
+	void releaseBuffer(uint32_t index, uint64_t retiredFrame);
+	// recycles released indices whose frames have finished
+	void collect(uint64_t completedFrames);
+	void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS, uint32_t setIndex = 0);
+	void clean();
+
+private:
+	// indices of one array, never handed out twice while the gpu may still read them
+	class Slots {
+	public:
+		uint32_t capacity = 0;
+		uint32_t next = 0;
+		std::vector<uint32_t> free;
+		// released indices paired with the frame they were released on
+		std::deque<std::pair<uint64_t, uint32_t>> retired;
+
+		uint32_t take();
+		void collect(uint64_t completedFrames);
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	// writes to the set must be externally synchronised
+	std::mutex lock;
+	Slots textures;
+	Slots buffers;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+CommandRecorder::CommandRecorder(Renderer& renderer, uint32_t threadCount) : workers(threadCount) {
+	device = renderer.device;
+	queueFamily = renderer.indices.graphicsFamily.value();
+	resize(renderer.scheduler.framesInFlight());
+}
+
+const std::vector<VkCommandBuffer>& CommandRecorder::record(Renderer& renderer, uint32_t slotIndex, uint32_t imageIndex) {
+	FrameSlot& slot = slots[slotIndex];
+	// everything recorded into the slot's last frame goes at once
+	for (auto& worker : slot.workers) {
+		vkResetCommandPool(device, worker.pool, 0);
+		worker.used = 0;
+	}
+
+	RenderTarget& target = renderer.target;
+	uint32_t draws = renderer.scene->visibleCount;
+	uint32_t tasks = std::clamp(draws / MIN_DRAWS_PER_TASK, 1u, workers.workerCount() * TASKS_PER_WORKER);
+	secondaries.resize(tasks);
+
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = renderer.renderPass;
+	inheritance.subpass = renderer.sceneSubpass;
+	inheritance.framebuffer = target.frameBuffers[imageIndex];
+	VkCommandBufferInheritanceInfo prepassInheritance = inheritance;
+	prepassInheritance.subpass = 0;
+
+	VkPipeline prepassPipeline = VK_NULL_HANDLE;
+	VkPipeline pipeline = renderer.scenePipeline(&prepassPipeline);
+	prepassSecondaries.resize(prepassPipeline != VK_NULL_HANDLE ? tasks : 0);
+	workers.run(tasks, [&](uint32_t task, uint32_t worker) {
+		uint32_t firstDraw = (uint32_t)((uint64_t)draws * task / tasks);
+		uint32_t endDraw = (uint32_t)((uint64_t)draws * (task + 1) / tasks);
+		// the same slice of draws in both subpasses, so each thread's vertices stay warm in its caches
+		if (prepassPipeline != VK_NULL_HANDLE)
+			prepassSecondaries[task] = recordTask(renderer, slot.workers[worker], prepassInheritance, prepassPipeline, firstDraw, endDraw);
+		secondaries[task] = recordTask(renderer, slot.workers[worker], inheritance, pipeline, firstDraw, endDraw);
+	});
+	return secondaries;
+}
+
+const std::vector<VkCommandBuffer>& CommandRecorder::prepassCommands() {
+	return prepassSecondaries;
+}
+
+VkCommandBuffer CommandRecorder::recordTask(Renderer& renderer, WorkerCommands& worker, const VkCommandBufferInheritanceInfo& inheritance,
+	VkPipeline pipeline, uint32_t firstDraw, uint32_t endDraw) {
+	RenderTarget& target = renderer.target;
+	VkCommandBuffer commandBuffer = nextSecondary(worker);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("failed to open secondary command buffer");
+
+	// secondary buffers inherit none of the primary's state
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	if (renderer.bindless != nullptr)
+		renderer.bindless->bind(commandBuffer, renderer.layoutBundle.layout,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, renderer.layoutBundle.bindlessSet);
+	if (renderer.transforms != nullptr)
+		renderer.transforms->bind(commandBuffer, renderer.layoutBundle.layout, renderer.layoutBundle.transformSet);
+	VkViewport viewport{ 0.0f, 0.0f, (float)target.size.width, (float)target.size.height, 0.0f, 1.0f };
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	VkRect2D scissor{ { 0, 0 }, target.size };
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	RenderTarget::recordDraws(renderer, commandBuffer, firstDraw, endDraw);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to record to secondary command buffer");
+	return commandBuffer;
+}
+
+void CommandRecorder::resize(uint32_t slotCount) {
+	while (slots.size() > slotCount) {
+		FrameSlot& slot = slots.back();
+		for (auto& worker : slot.workers)
+			vkDestroyCommandPool(device, worker.pool, nullptr);
+		slots.pop_back();
+	}
+	while (slots.size() < slotCount) {
+		FrameSlot slot;
+		slot.workers.resize(workers.workerCount());
+		for (auto& worker : slot.workers)
+			worker.pool = createPool();
+		slots.push_back(slot);
+	}
+}
+
+void CommandRecorder::clean() {
+	resize(0);
+}
+
+VkCommandPool CommandRecorder::createPool() {
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	VkCommandPool pool;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create command pool");
+	return pool;
+}
+
+// buffers survive a pool reset, so they are allocated once and reused every time the slot comes around
+VkCommandBuffer CommandRecorder::nextSecondary(WorkerCommands& worker) {
+	if (worker.used == worker.buffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = worker.pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate secondary command buffer");
+		worker.buffers.push_back(commandBuffer);
+	}
+	return worker.buffers[worker.used++];
+}
@@ -0,0 +1,62 @@
+#ifndef CommandRecorder_h
+#define CommandRecorder_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "WorkerPool.h"
+
+class Renderer;
+
+// splits the scene's draws into secondary command buffers recorded in parallel, executed by the frame's primary
+// each frame slot owns a command pool per worker thread, so workers never share a pool and
+// a slot's pools are reset wholesale once the gpu has finished the frame that last used them
+class CommandRecorder {
+public:
+	// slices smaller than this cost more to set up than they save
+	static const uint32_t MIN_DRAWS_PER_TASK = 256;
+	// slices per worker, so threads that finish early can take over another's work
+	static const uint32_t TASKS_PER_WORKER = 4;
+	WorkerPool workers;
+
+	CommandRecorder(Renderer& renderer, uint32_t threadCount);
+	// only call once the frame slot's previous frame has finished on the gpu
+	// the returned buffers stay valid until the next call
+	const std::vector<VkCommandBuffer>& record(Renderer& renderer, uint32_t slot, uint32_t imageIndex);
+	// the depth prepass's buffers from the last record, one per task, empty when there is no prepass
+	const std::vector<VkCommandBuffer>& prepassCommands();
+	// the gpu must be idle
+	void resize(uint32_t slotCount);
+	void clean();
+
+private:
+	class WorkerCommands {
+	public:
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> buffers;
+		// buffers handed out since the pool was last reset
+		uint32_t used = 0;
+	};
+
+	class FrameSlot {
+	public:
+		std::vector<WorkerCommands> workers;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t queueFamily = 0;
+	std::vector<FrameSlot> slots;
+	// the secondary buffer of each task, executed in task order
+	std::vector<VkCommandBuffer> secondaries;
+	std::vector<VkCommandBuffer> prepassSecondaries;
+
+	VkCommandPool createPool();
+	VkCommandBuffer nextSecondary(WorkerCommands& worker);
+	// records the task's share of the draws for one subpass
+	VkCommandBuffer recordTask(Renderer& renderer, WorkerCommands& worker, const VkCommandBufferInheritanceInfo& inheritance,
+		VkPipeline pipeline, uint32_t firstDraw, uint32_t endDraw);
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "ComputePipeline.h"
+
+#include <stdexcept>
+
+#include "Renderer.h"
+
+ComputePipeline::ComputePipeline() {}
+
+ComputePipeline::ComputePipeline(Renderer& renderer, const std::string& path, const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize) {
+	module = renderer.loadShader(path);
+
+	VkPushConstantRange pushRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize };
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = (uint32_t)setLayouts.size();
+	layoutInfo.pSetLayouts = setLayouts.data();
+	layoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	if (vkCreatePipelineLayout(renderer.device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create compute pipeline layout");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = module->shaderCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = layout;
+	if (vkCreateComputePipelines(renderer.device, renderer.pipelineCache.cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		throw std::runtime_error("failed to create compute pipeline " + path);
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+}
+
+void ComputePipeline::bindSet(VkCommandBuffer commandBuffer, VkDescriptorSet set, uint32_t index) {
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, index, 1, &set, 0, nullptr);
+}
+
+void ComputePipeline::push(VkCommandBuffer commandBuffer, const void* data, uint32_t size) {
+	vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+}
+
+void ComputePipeline::dispatch(VkCommandBuffer commandBuffer, uint32_t count, uint32_t groupSize) {
+	vkCmdDispatch(commandBuffer, (count + groupSize - 1) / groupSize, 1, 1);
+}
+
+void ComputePipeline::clean(VkDevice device) {
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, layout, nullptr);
+	delete module;
+}
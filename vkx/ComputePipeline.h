@@ -0,0 +1,32 @@
+#ifndef ComputePipeline_h
+#define ComputePipeline_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+#include "ShaderModule.h"
+
+class Renderer;
+
+// a compute shader with its pipeline layout, push constants are visible to the compute stage only
+class ComputePipeline {
+public:
+	ShaderModule* module = nullptr;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	ComputePipeline();
+	ComputePipeline(Renderer& renderer, const std::string& path, const std::vector<VkDescriptorSetLayout>& setLayouts,
+		uint32_t pushConstantSize = 0);
+	void bind(VkCommandBuffer commandBuffer);
+	void bindSet(VkCommandBuffer commandBuffer, VkDescriptorSet set, uint32_t index = 0);
+	void push(VkCommandBuffer commandBuffer, const void* data, uint32_t size);
+	// dispatches enough workgroups of groupSize invocations to cover count invocations
+	void dispatch(VkCommandBuffer commandBuffer, uint32_t count, uint32_t groupSize);
+	void clean(VkDevice device);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "ComputeQueue.h"
+
+#include <stdexcept>
+
+#include "Renderer.h"
+
+ComputeQueue::ComputeQueue(Renderer& renderer) {
+	device = renderer.device;
+	queue = renderer.computeQueue;
+	queueLock = &renderer.queueLock(queue);
+	family = renderer.indices.computeFamily.value_or(renderer.indices.graphicsFamily.value());
+	// the graphics submit carries the wait, so both must agree on the kind of semaphore
+	timeline = renderer.scheduler.timeline;
+	if (timeline) {
+		VkSemaphoreTypeCreateInfoKHR typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &counter) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute timeline semaphore");
+	}
+	resize(renderer.scheduler.framesInFlight());
+}
+
+VkCommandBuffer ComputeQueue::begin(uint32_t slot) {
+	vkResetCommandPool(device, slots[slot].pool, 0);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(slots[slot].commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("failed to open compute command buffer");
+	return slots[slot].commandBuffer;
+}
+
+void ComputeQueue::submit(uint32_t slot, FrameScheduler& scheduler, VkPipelineStageFlags waitStage) {
+	if (vkEndCommandBuffer(slots[slot].commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to record compute command buffer");
+
+	uint64_t value = ++submitted;
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSemaphore signal = timeline ? counter : slots[slot].done;
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = timeline ? &timelineInfo : nullptr;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &slots[slot].commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &signal;
+	{
+		std::lock_guard<std::mutex> guard(*queueLock);
+		if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit to compute queue");
+	}
+	// the semaphore's signal makes the compute writes visible to the waiting stage, no barrier is needed
+	scheduler.addWait(signal, value, waitStage);
+}
+
+void ComputeQueue::resize(uint32_t slotCount) {
+	while (slots.size() > slotCount) {
+		vkDestroyCommandPool(device, slots.back().pool, nullptr);
+		vkDestroySemaphore(device, slots.back().done, nullptr);
+		slots.pop_back();
+	}
+	while (slots.size() < slotCount) {
+		Slot slot;
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = family;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &slot.pool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute command pool");
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = slot.pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate compute command buffer");
+
+		if (!timeline) {
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &slot.done) != VK_SUCCESS)
+				throw std::runtime_error("failed to create compute semaphore");
+		}
+		slots.push_back(slot);
+	}
+}
+
+void ComputeQueue::clean() {
+	resize(0);
+	vkDestroySemaphore(device, counter, nullptr);
+}
@@ -0,0 +1,49 @@
+#ifndef ComputeQueue_h
+#define ComputeQueue_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <mutex>
+#include <vector>
+
+class Renderer;
+class FrameScheduler;
+
+// records and submits compute work on the async compute queue, one command buffer per frame slot
+// each submit is handed to the graphics queue through a semaphore that the frame's submit waits on,
+// so the compute work overlaps whatever the graphics queue is still running from earlier frames
+class ComputeQueue {
+public:
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t family = 0;
+	// signalled to the number of submits so far when timeline semaphores are available
+	bool timeline = false;
+
+	ComputeQueue(Renderer& renderer);
+	// only call once the frame slot's previous frame has finished on the gpu
+	VkCommandBuffer begin(uint32_t slot);
+	// submits the slot's commands and makes the scheduler's next frame wait for them at waitStage
+	void submit(uint32_t slot, FrameScheduler& scheduler, VkPipelineStageFlags waitStage);
+	// the gpu must be idle
+	void resize(uint32_t slotCount);
+	void clean();
+
+private:
+	class Slot {
+	public:
+		VkCommandPool pool = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		// without timeline semaphores each slot signals a semaphore of its own
+		VkSemaphore done = VK_NULL_HANDLE;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	// the queue can be the transfer queue, which uploads submit to from other threads
+	std::mutex* queueLock = nullptr;
+	VkSemaphore counter = VK_NULL_HANDLE;
+	uint64_t submitted = 0;
+	std::vector<Slot> slots;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "DescriptorAllocator.h"
+
+#include <stdexcept>
+
+DescriptorAllocator::DescriptorAllocator() {}
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device) {
+	this->device = device;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	if (pools.empty())
+		pools.push_back(createPool());
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	allocInfo.descriptorPool = pools[current];
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		// a full pool stays full until the next reset, move on to an empty one
+		current++;
+		if (current == pools.size())
+			pools.push_back(createPool());
+		allocInfo.descriptorPool = pools[current];
+		result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	}
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate frame descriptor set");
+	return set;
+}
+
+void DescriptorAllocator::reset() {
+	// pools past current were never touched since the last reset
+	for (uint32_t i = 0; i < pools.size() && i <= current; i++)
+		vkResetDescriptorPool(device, pools[i], 0);
+	current = 0;
+}
+
+void DescriptorAllocator::clean() {
+	for (auto pool : pools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	pools.clear();
+	current = 0;
+}
+
+uint32_t DescriptorAllocator::poolCount() {
+	return (uint32_t)pools.size();
+}
+
+VkDescriptorPool DescriptorAllocator::createPool() {
+	// weighted towards the uniform buffers and textures most draws bind
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * SETS_PER_POOL },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, SETS_PER_POOL },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * SETS_PER_POOL },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * SETS_PER_POOL },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, SETS_PER_POOL },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, SETS_PER_POOL / 2 }
+	};
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	// no FREE_DESCRIPTOR_SET_BIT, sets are only released by resetting the whole pool
+	poolInfo.maxSets = SETS_PER_POOL;
+	poolInfo.poolSizeCount = sizeof(poolSizes) / sizeof(VkDescriptorPoolSize);
+	poolInfo.pPoolSizes = poolSizes;
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create frame descriptor pool");
+	return pool;
+}
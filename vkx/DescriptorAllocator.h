@@ -0,0 +1,35 @@
+#ifndef DescriptorAllocator_h
+#define DescriptorAllocator_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+// hands out descriptor sets that live for one frame from a growing list of pools
+// sets are never freed one by one, reset() recycles every pool in one call per pool once the frame has finished
+class DescriptorAllocator {
+public:
+	// sets per pool, descriptors of each type are reserved in proportion
+	static const uint32_t SETS_PER_POOL = 256;
+
+	DescriptorAllocator();
+	DescriptorAllocator(VkDevice device);
+	// a new pool is opened when the current one runs out, so this only fails when the device is out of memory
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+	// only call once the gpu has finished with every set handed out since the last reset
+	void reset();
+	void clean();
+	// pools opened so far, frames that need more than one are worth a larger SETS_PER_POOL
+	uint32_t poolCount();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	// pools up to current have sets handed out, the rest are empty
+	std::vector<VkDescriptorPool> pools;
+	uint32_t current = 0;
+
+	VkDescriptorPool createPool();
+};
+
+#endif
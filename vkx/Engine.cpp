@@ -2,12 +2,79 @@
 
 #include "Renderer.h"
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main() {
-	Renderer app;
+int main(int argc, char** argv) {
+	RenderSettings settings;
+	std::vector<std::string> texturePaths;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--headless")
+			settings.headless = true;
+		else if (arg == "--frames" && i + 1 < argc)
+			settings.frameLimit = std::stoull(argv[++i]);
+		else if (arg == "--frames-in-flight" && i + 1 < argc)
+			settings.framesInFlight = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--no-timeline")
+			settings.timelineSemaphores = false;
+		else if (arg == "--msaa" && i + 1 < argc)
+			settings.msaaSamples = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--depth-prepass")
+			settings.depthPrepass = true;
+		else if (arg == "--gpu-culling")
+			settings.gpuCulling = true;
+		else if (arg == "--cpu-culling")
+			settings.cpuCulling = true;
+		else if (arg == "--cull-threads" && i + 1 < argc)
+			settings.cullThreads = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--visible-fraction" && i + 1 < argc)
+			settings.visibleFraction = std::stof(argv[++i]);
+		else if (arg == "--transform-fanout" && i + 1 < argc)
+			settings.transformFanout = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--animated-nodes" && i + 1 < argc)
+			settings.animatedNodes = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--transform-threads" && i + 1 < argc)
+			settings.transformThreads = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--async-compute")
+			settings.asyncCompute = true;
+		else if (arg == "--draw-data" && i + 1 < argc)
+			parseDrawData(argv[++i], settings.drawData);
+		else if (arg == "--bindless")
+			settings.bindless = true;
+		else if (arg == "--static-commands")
+			settings.recordEachFrame = false;
+		else if (arg == "--record-threads" && i + 1 < argc)
+			settings.recordThreads = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "--present" && i + 1 < argc)
+			parsePresentPolicy(argv[++i], settings.presentPolicy);
+		else if (arg == "--latency")
+			settings.measureLatency = true;
+		else if (arg == "--verbose")
+			settings.verbose = true;
+		else if (arg == "--trace" && i + 1 < argc)
+			settings.tracePath = argv[++i];
+		else if (arg == "--mesh" && i + 1 < argc)
+			settings.meshPath = argv[++i];
+		else if (arg == "--texture" && i + 1 < argc)
+			texturePaths.push_back(argv[++i]);
+		else if (arg == "--texture-budget" && i + 1 < argc)
+			settings.textureBudget = std::stoull(argv[++i]) << 20;
+	}
 
 	try {
+		Renderer app(settings);
+		for (auto& path : texturePaths)
+			app.textures->open(path);
 		app.run();
+		if (app.latency != nullptr)
+			app.latency->report(std::cout);
+		if (app.settings.cpuCulling && app.scene->culls > 0)
+			std::cout << "culling " << app.scene->objectCount() << " objects with the " << cullKernelName(app.scene->kernel) << " kernel took "
+				<< app.scene->totalCullMs / app.scene->culls << " ms per frame, " << app.scene->visibleCount << " stayed visible\n";
+		if (app.transforms != nullptr && app.transforms->updates > 0)
+			std::cout << "updating " << app.transforms->nodeCount() << " transforms over " << app.transforms->levelStart.size() << " levels took "
+				<< app.transforms->totalUpdateMs / app.transforms->updates << " ms per frame\n";
 	}
 	catch (const std::exception& e) {
 		std::cerr << e.what() << '\n';
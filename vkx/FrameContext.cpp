@@ -0,0 +1,48 @@
+#include "FrameContext.h"
+
+#include <stdexcept>
+
+#include "Renderer.h"
+
+FrameContext::FrameContext() {}
+
+FrameContext::FrameContext(Renderer& renderer) {
+	device = renderer.device;
+	descriptors = DescriptorAllocator(device);
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = renderer.indices.graphicsFamily.value();
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create frame command pool");
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate frame command buffer");
+}
+
+VkCommandBuffer FrameContext::begin() {
+	vkResetCommandPool(device, pool, 0);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	// submitted once and never in two frames at a time, which leaves the driver free to optimise it
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("failed to open frame command buffer");
+	return commandBuffer;
+}
+
+void FrameContext::end() {
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to record frame command buffer");
+}
+
+void FrameContext::clean() {
+	// freeing the pool frees its command buffer too
+	vkDestroyCommandPool(device, pool, nullptr);
+	descriptors.clean();
+}
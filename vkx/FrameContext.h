@@ -0,0 +1,32 @@
+#ifndef FrameContext_h
+#define FrameContext_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "DescriptorAllocator.h"
+
+class Renderer;
+
+// per frame slot state that is rebuilt every frame, reused once the slot's previous frame has finished
+class FrameContext {
+public:
+	// transient, so the driver can expect its memory to be recycled every frame
+	VkCommandPool pool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	// descriptor sets written for this frame only, such as the transform hierarchy's
+	// reset by the renderer once the slot's gate has signalled, before anything of the frame allocates from it
+	DescriptorAllocator descriptors;
+
+	FrameContext();
+	FrameContext(Renderer& renderer);
+	// resets the command pool, releasing last frame's commands in one call, and opens the command buffer
+	VkCommandBuffer begin();
+	void end();
+	void clean();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+};
+
+#endif
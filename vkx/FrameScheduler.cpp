@@ -0,0 +1,152 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+FrameScheduler::FrameScheduler() {}
+
+FrameScheduler::FrameScheduler(Renderer& renderer) {
+	device = renderer.device;
+	timeline = renderer.timelineSemaphores;
+	if (timeline) {
+		waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+		getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+		timeline = waitSemaphores != nullptr && getCounterValue != nullptr;
+	}
+	if (timeline) {
+		VkSemaphoreTypeCreateInfoKHR typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeInfo.initialValue = 0;
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &counter) != VK_SUCCESS)
+			throw std::runtime_error("failed to create timeline semaphore");
+	}
+	resize(renderer.settings.framesInFlight);
+}
+
+uint32_t FrameScheduler::framesInFlight() {
+	return (uint32_t)gates.size();
+}
+
+RenderGate* FrameScheduler::beginFrame(uint64_t frame) {
+	RenderGate* gate = gates[frame % gates.size()];
+	auto start = std::chrono::steady_clock::now();
+	if (timeline)
+		waitForValue(gate->frameNumber);
+	else
+		vkWaitForFences(device, 1, &gate->occupation, VK_TRUE, UINT64_MAX);
+	knownComplete = std::max(knownComplete, gate->frameNumber);
+	lastWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	totalWaitMs += lastWaitMs;
+	return gate;
+}
+
+void FrameScheduler::addWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage) {
+	extraWaits.push_back(semaphore);
+	extraWaitValues.push_back(value);
+	extraWaitStages.push_back(stage);
+}
+
+VkFence FrameScheduler::prepareSubmit(uint64_t frame, RenderGate* gate, VkSubmitInfo& submitInfo) {
+	gate->frameNumber = frame + 1;
+	lastSubmitted = std::max(lastSubmitted, gate->frameNumber);
+
+	// binary semaphores ignore their value
+	waitValues.assign(submitInfo.waitSemaphoreCount, 0);
+	if (!extraWaits.empty()) {
+		waitSemaphoreList.assign(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+		waitStageList.assign(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+		waitSemaphoreList.insert(waitSemaphoreList.end(), extraWaits.begin(), extraWaits.end());
+		waitStageList.insert(waitStageList.end(), extraWaitStages.begin(), extraWaitStages.end());
+		waitValues.insert(waitValues.end(), extraWaitValues.begin(), extraWaitValues.end());
+		submitInfo.waitSemaphoreCount = (uint32_t)waitSemaphoreList.size();
+		submitInfo.pWaitSemaphores = waitSemaphoreList.data();
+		submitInfo.pWaitDstStageMask = waitStageList.data();
+		extraWaits.clear();
+		extraWaitValues.clear();
+		extraWaitStages.clear();
+	}
+
+	if (!timeline) {
+		// reset only once a submit is certain, a skipped frame must leave the fence signalled
+		vkResetFences(device, 1, &gate->occupation);
+		return gate->occupation;
+	}
+
+	signalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	signalSemaphores.push_back(counter);
+	signalValues.assign(signalSemaphores.size(), 0);
+	signalValues.back() = gate->frameNumber;
+
+	timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.pNext = submitInfo.pNext;
+	timelineInfo.waitSemaphoreValueCount = (uint32_t)waitValues.size();
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = (uint32_t)signalValues.size();
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+	return VK_NULL_HANDLE;
+}
+
+uint64_t FrameScheduler::completedFrames() {
+	if (timeline) {
+		uint64_t value = 0;
+		if (getCounterValue(device, counter, &value) == VK_SUCCESS)
+			knownComplete = std::max(knownComplete, value);
+	}
+	return knownComplete;
+}
+
+void FrameScheduler::waitIdle() {
+	if (timeline)
+		waitForValue(lastSubmitted);
+	else {
+		for (auto& gate : gates) {
+			vkWaitForFences(device, 1, &gate->occupation, VK_TRUE, UINT64_MAX);
+		}
+	}
+	knownComplete = lastSubmitted;
+}
+
+void FrameScheduler::resize(uint32_t framesInFlight) {
+	framesInFlight = std::max(framesInFlight, 1u);
+	// frames map onto gates by index, so no gate may be busy while the ring changes size
+	waitIdle();
+	while (gates.size() > framesInFlight) {
+		delete gates.back();
+		gates.pop_back();
+	}
+	while (gates.size() < framesInFlight) {
+		gates.push_back(new RenderGate(device));
+	}
+}
+
+void FrameScheduler::clean() {
+	for (auto& gate : gates) {
+		delete gate;
+	}
+	gates.clear();
+	vkDestroySemaphore(device, counter, nullptr);
+}
+
+void FrameScheduler::waitForValue(uint64_t value) {
+	if (value == 0)
+		return;
+	VkSemaphoreWaitInfoKHR waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &counter;
+	waitInfo.pValues = &value;
+	if (waitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		throw std::runtime_error("failed to wait on timeline semaphore");
+}
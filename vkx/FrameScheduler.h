@@ -0,0 +1,61 @@
+#ifndef FrameScheduler_h
+#define FrameScheduler_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "RenderGate.h"
+
+class Renderer;
+
+// paces the cpu against the gpu over a ring of RenderGates
+// frame n signals a single timeline counter to n + 1, falling back to each gate's fence without timeline semaphores
+class FrameScheduler {
+public:
+	bool timeline = false;
+	std::vector<RenderGate*> gates;
+	// cpu time blocked waiting for the gpu to free a gate
+	double lastWaitMs = 0;
+	double totalWaitMs = 0;
+
+	FrameScheduler();
+	FrameScheduler(Renderer& renderer);
+	uint32_t framesInFlight();
+	// blocks until the gate for this frame is no longer used by the gpu
+	RenderGate* beginFrame(uint64_t frame);
+	// makes the next frame's submit wait for another queue's work, value is ignored for binary semaphores
+	void addWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+	// adds the frame's completion signal and extra waits to submitInfo and returns the fence to submit with
+	VkFence prepareSubmit(uint64_t frame, RenderGate* gate, VkSubmitInfo& submitInfo);
+	// number of frames from the start that the gpu is known to have finished
+	uint64_t completedFrames();
+	void waitIdle();
+	// drains the gpu, then grows or shrinks the ring
+	void resize(uint32_t framesInFlight);
+	void clean();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore counter = VK_NULL_HANDLE;
+	PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR getCounterValue = nullptr;
+	uint64_t knownComplete = 0;
+	uint64_t lastSubmitted = 0;
+	// waits added since the last submit
+	std::vector<VkSemaphore> extraWaits;
+	std::vector<uint64_t> extraWaitValues;
+	std::vector<VkPipelineStageFlags> extraWaitStages;
+	// storage the submit info points into until the next prepareSubmit
+	std::vector<VkSemaphore> waitSemaphoreList;
+	std::vector<VkPipelineStageFlags> waitStageList;
+	std::vector<VkSemaphore> signalSemaphores;
+	std::vector<uint64_t> signalValues;
+	std::vector<uint64_t> waitValues;
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+
+	void waitForValue(uint64_t value);
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "GpuCuller.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "Renderer.h"
+
+// push constants of cull.comp
+class CullConstants {
+public:
+	float frustum[6][4];
+	uint32_t objectCount;
+	uint32_t compact;
+	uint32_t indexCount;
+};
+
+GpuCuller::GpuCuller(Renderer& renderer) {
+	device = renderer.device;
+	allocator = renderer.allocator;
+	mesh = renderer.mesh;
+	scene = renderer.scene;
+	objectCount = scene->objectCount();
+	multiDraw = renderer.enabledFeatures.multiDrawIndirect == VK_TRUE;
+	if (renderer.drawIndirectCount)
+		drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+	// a count buffer only pays off when one call can draw a variable number of commands
+	compact = drawIndexedIndirectCount != nullptr && multiDraw;
+	async = renderer.compute != nullptr;
+	// shared buffers need no ownership transfers between the queues that use them
+	if (async) {
+		families = { renderer.indices.graphicsFamily.value(), renderer.compute->family };
+		if (renderer.indices.transferFamily.has_value())
+			families.push_back(renderer.indices.transferFamily.value());
+		std::sort(families.begin(), families.end());
+		families.erase(std::unique(families.begin(), families.end()), families.end());
+		if (families.size() < 2)
+			families.clear();
+	}
+
+	objects = createBuffer(sizeof(CullObject) * objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, objectMemory);
+	indices = createBuffer(sizeof(uint16_t) * 3, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, indexMemory);
+	uploadObjects(renderer);
+	initLayout();
+	pipeline = ComputePipeline(renderer, "shaders/cull.spv", { setLayout }, sizeof(CullConstants));
+	// draw commands are rewritten every frame, so frames in flight can't share them once culling leaves the graphics queue
+	resize(async ? renderer.scheduler.framesInFlight() : 1);
+}
+
+void GpuCuller::beginFrame(uint32_t frameSlot) {
+	currentSlot = frameSlot % (uint32_t)slots.size();
+}
+
+void GpuCuller::recordCull(VkCommandBuffer commandBuffer) {
+	recordClear(commandBuffer);
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = slots[currentSlot].count;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	recordDispatch(commandBuffer);
+}
+
+void GpuCuller::recordClear(VkCommandBuffer commandBuffer) {
+	vkCmdFillBuffer(commandBuffer, slots[currentSlot].count, 0, sizeof(uint32_t), 0);
+}
+
+void GpuCuller::recordDispatch(VkCommandBuffer commandBuffer) {
+	CullConstants constants;
+	memcpy(constants.frustum, scene->frustum, sizeof(scene->frustum));
+	constants.objectCount = objectCount;
+	constants.compact = compact ? 1 : 0;
+	constants.indexCount = mesh != nullptr ? mesh->indexCount : 3;
+	pipeline.bind(commandBuffer);
+	pipeline.bindSet(commandBuffer, slots[currentSlot].descriptorSet);
+	pipeline.push(commandBuffer, &constants, sizeof(constants));
+	pipeline.dispatch(commandBuffer, objectCount, WORKGROUP_SIZE);
+}
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer) {
+	Slot& slot = slots[currentSlot];
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (mesh != nullptr)
+		mesh->bind(commandBuffer);
+	else
+		vkCmdBindIndexBuffer(commandBuffer, indices, 0, VK_INDEX_TYPE_UINT16);
+	if (compact)
+		drawIndexedIndirectCount(commandBuffer, slot.draws, 0, slot.count, 0, objectCount, stride);
+	else if (multiDraw)
+		vkCmdDrawIndexedIndirect(commandBuffer, slot.draws, 0, objectCount, stride);
+	else {
+		for (uint32_t i = 0; i < objectCount; i++)
+			vkCmdDrawIndexedIndirect(commandBuffer, slot.draws, (VkDeviceSize)i * stride, 1, stride);
+	}
+}
+
+void GpuCuller::resize(uint32_t slotCount) {
+	for (auto& slot : slots) {
+		vkDestroyBuffer(device, slot.draws, nullptr);
+		vkDestroyBuffer(device, slot.count, nullptr);
+		allocator->free(slot.drawMemory);
+		allocator->free(slot.countMemory);
+	}
+	slots.clear();
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	descriptorPool = VK_NULL_HANDLE;
+	if (slotCount == 0)
+		return;
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * slotCount };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = slotCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create culling descriptor pool");
+
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+	slots.resize(slotCount);
+	for (auto& slot : slots) {
+		slot.draws = createBuffer(sizeof(VkDrawIndexedIndirectCommand) * objectCount, usage, slot.drawMemory);
+		slot.count = createBuffer(sizeof(uint32_t), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, slot.countMemory);
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayout;
+		if (vkAllocateDescriptorSets(device, &allocInfo, &slot.descriptorSet) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate culling descriptor set");
+
+		VkDescriptorBufferInfo bufferInfos[3] = {
+			{ objects, 0, VK_WHOLE_SIZE },
+			{ slot.draws, 0, VK_WHOLE_SIZE },
+			{ slot.count, 0, VK_WHOLE_SIZE }
+		};
+		VkWriteDescriptorSet writes[3]{};
+		for (uint32_t i = 0; i < 3; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = slot.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+	}
+	currentSlot = 0;
+}
+
+void GpuCuller::clean() {
+	resize(0);
+	pipeline.clean(device);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	vkDestroyBuffer(device, objects, nullptr);
+	vkDestroyBuffer(device, indices, nullptr);
+	allocator->free(objectMemory);
+	allocator->free(indexMemory);
+}
+
+VkBuffer GpuCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryAllocation& memory) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	if (families.empty())
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = (uint32_t)families.size();
+		bufferInfo.pQueueFamilyIndices = families.data();
+	}
+	VkBuffer buffer;
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to create culling buffer");
+	memory = allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	return buffer;
+}
+
+// the scene's bounds and instance runs, interleaved the way the shader reads them
+void GpuCuller::uploadObjects(Renderer& renderer) {
+	std::vector<CullObject> data(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		CullObject& object = data[i];
+		object.sphere[0] = scene->centerX[i];
+		object.sphere[1] = scene->centerY[i];
+		object.sphere[2] = scene->centerZ[i];
+		object.sphere[3] = scene->radius[i];
+		object.firstInstance = scene->firstInstance[i];
+		object.instanceCount = scene->instanceCount[i];
+		object.padding[0] = object.padding[1] = 0;
+	}
+
+	// large scenes are split so every piece fits in the staging ring
+	VkDeviceSize chunk = renderer.uploads->stagingSize / 2 / sizeof(CullObject) * sizeof(CullObject);
+	VkDeviceSize size = data.size() * sizeof(CullObject);
+	bool concurrent = !families.empty();
+	for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+		renderer.uploads->uploadBuffer(objects, offset, reinterpret_cast<const char*>(data.data()) + offset, std::min(chunk, size - offset), concurrent);
+	uint16_t triangle[] = { 0, 1, 2 };
+	uint64_t token = renderer.uploads->uploadBuffer(indices, 0, triangle, sizeof(triangle), concurrent);
+	// the compute queue doesn't wait on upload batches, so the objects must have landed before the first cull
+	if (async)
+		renderer.uploads->wait(token);
+}
+
+void GpuCuller::initLayout() {
+	// objects, draw commands and the draw count
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	for (uint32_t i = 0; i < 3; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = 3;
+	setLayoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create culling descriptor set layout");
+}
@@ -0,0 +1,92 @@
+#ifndef GpuCuller_h
+#define GpuCuller_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "ComputePipeline.h"
+
+class Renderer;
+class Mesh;
+class SceneStore;
+
+// per object data read by the culling shader, laid out to match cull.comp
+class CullObject {
+public:
+	// bounding sphere, xyz is the centre and w the radius
+	float sphere[4];
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	uint32_t padding[2];
+};
+
+// draws the scene from the gpu: a compute pass tests every object against the frustum and writes
+// an indexed indirect command for each survivor, so recording costs the same whatever the object count
+// survivors are compacted and drawn with vkCmdDrawIndexedIndirectCount when the device has it,
+// otherwise culled objects keep their slot with no instances and every slot is drawn
+class GpuCuller {
+public:
+	static const uint32_t WORKGROUP_SIZE = 64;
+	uint32_t objectCount = 0;
+	bool compact = false;
+	// one multi draw call for every object, otherwise a call per object
+	bool multiDraw = false;
+	// culling runs on the async compute queue, with a set of draw buffers per frame in flight
+	bool async = false;
+
+	GpuCuller(Renderer& renderer);
+	// picks the draw buffers used by the following calls
+	void beginFrame(uint32_t frameSlot);
+	// the async compute queue's whole culling pass, clearing the count and culling with the barrier between them
+	// the semaphore handing the frame to the graphics queue orders it against the draws
+	void recordCull(VkCommandBuffer commandBuffer);
+	// the two halves of recordCull on the graphics queue, where the frame's render graph places the barriers
+	// the draw count is cleared with a transfer, then read and written by the culling dispatch
+	void recordClear(VkCommandBuffer commandBuffer);
+	void recordDispatch(VkCommandBuffer commandBuffer);
+	// must be recorded inside the render pass with the graphics pipeline bound
+	void recordDraws(VkCommandBuffer commandBuffer);
+	// the gpu must be idle
+	void resize(uint32_t slotCount);
+	void clean();
+
+private:
+	class Slot {
+	public:
+		VkBuffer draws = VK_NULL_HANDLE;
+		VkBuffer count = VK_NULL_HANDLE;
+		MemoryAllocation drawMemory;
+		MemoryAllocation countMemory;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+	// drawn instead of the built in triangle when the renderer has one
+	Mesh* mesh = nullptr;
+	// the objects culled, against its frustum
+	SceneStore* scene = nullptr;
+	PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+	// families sharing the buffers, empty when only the graphics queue touches them
+	std::vector<uint32_t> families;
+
+	VkBuffer objects = VK_NULL_HANDLE;
+	VkBuffer indices = VK_NULL_HANDLE;
+	MemoryAllocation objectMemory;
+	MemoryAllocation indexMemory;
+	std::vector<Slot> slots;
+	uint32_t currentSlot = 0;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	ComputePipeline pipeline;
+
+	VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryAllocation& memory);
+	void uploadObjects(Renderer& renderer);
+	void initLayout();
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+#include "TraceWriter.h"
+
+GpuProfiler::GpuProfiler() {}
+
+GpuProfiler::GpuProfiler(Renderer& renderer) {
+	device = renderer.device;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	period = props.limits.timestampPeriod;
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer.physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer.physicalDevice, &familyCount, families.data());
+	uint32_t validBits = families[renderer.indices.graphicsFamily.value()].timestampValidBits;
+
+	// a family reporting zero valid bits doesn't support timestamps at all
+	enabled = renderer.settings.profileGpu && validBits > 0 && period > 0;
+	validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	// a value and an availability word per query
+	results.resize(MAX_ZONES * 2 * 2);
+}
+
+void GpuProfiler::reserve(uint32_t slotCount) {
+	if (!enabled)
+		return;
+	// pools are only ever added, a rebuilt target may still have frames in flight using the old ones
+	while (slots.size() < slotCount) {
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = MAX_ZONES * 2;
+
+		Slot slot;
+		if (vkCreateQueryPool(device, &poolInfo, nullptr, &slot.pool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create timestamp query pool");
+		slots.push_back(slot);
+	}
+}
+
+void GpuProfiler::beginRecording(VkCommandBuffer commandBuffer, uint32_t slot) {
+	if (!enabled)
+		return;
+	slots[slot].zoneNames.clear();
+	slots[slot].pending = false;
+	vkCmdResetQueryPool(commandBuffer, slots[slot].pool, 0, MAX_ZONES * 2);
+}
+
+uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name) {
+	if (!enabled || slots[slot].zoneNames.size() >= MAX_ZONES)
+		return MAX_ZONES;
+	uint32_t zone = (uint32_t)slots[slot].zoneNames.size();
+	slots[slot].zoneNames.push_back(name);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slots[slot].pool, zone * 2);
+	return zone;
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone) {
+	if (!enabled || zone >= MAX_ZONES)
+		return;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slots[slot].pool, zone * 2 + 1);
+}
+
+void GpuProfiler::submitted(uint32_t slot, uint64_t cpuNs) {
+	if (!enabled)
+		return;
+	slots[slot].submitNs = cpuNs;
+	slots[slot].pending = true;
+}
+
+bool GpuProfiler::collect(uint32_t slot, TraceWriter& trace) {
+	if (!enabled || slot >= slots.size() || !slots[slot].pending || slots[slot].zoneNames.empty())
+		return false;
+	Slot& source = slots[slot];
+	source.pending = false;
+
+	uint32_t queryCount = (uint32_t)source.zoneNames.size() * 2;
+	// no wait bit, availability is reported per query instead
+	vkGetQueryPoolResults(device, source.pool, 0, queryCount, queryCount * 2 * sizeof(uint64_t), results.data(),
+		2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	for (uint32_t i = 0; i < queryCount; i++) {
+		if (results[i * 2 + 1] == 0) {
+			droppedFrames++;
+			return false;
+		}
+	}
+
+	uint64_t origin = results[0] & validMask;
+	uint64_t last = origin;
+	for (uint32_t i = 0; i < queryCount; i++) {
+		uint64_t ticks = results[i * 2] & validMask;
+		origin = std::min(origin, ticks);
+		last = std::max(last, ticks);
+	}
+
+	lastFrame.clear();
+	for (uint32_t zone = 0; zone < source.zoneNames.size(); zone++) {
+		uint64_t begin = results[zone * 4] & validMask;
+		uint64_t end = results[zone * 4 + 2] & validMask;
+		GpuZoneTiming timing;
+		timing.name = source.zoneNames[zone];
+		timing.startNs = (uint64_t)((begin - origin) * period);
+		timing.durationNs = (uint64_t)(((end - begin) & validMask) * period);
+		lastFrame.push_back(timing);
+		// the gpu clock has no known relation to the cpu one, so zones are placed after the submit that ran them
+		trace.complete(timing.name, "gpu", TraceWriter::GPU_TRACK, source.submitNs + timing.startNs, timing.durationNs);
+	}
+	lastFrameMs = (last - origin) * period / 1000000.0;
+	collectedFrames++;
+	return true;
+}
+
+void GpuProfiler::clean() {
+	for (auto& slot : slots) {
+		vkDestroyQueryPool(device, slot.pool, nullptr);
+	}
+	slots.clear();
+}
+
+GpuZone::GpuZone(GpuProfiler& profiler, VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name)
+	: profiler(profiler), commandBuffer(commandBuffer), slot(slot) {
+	zone = profiler.beginZone(commandBuffer, slot, name);
+}
+
+GpuZone::~GpuZone() {
+	profiler.endZone(commandBuffer, slot, zone);
+}
@@ -0,0 +1,80 @@
+#ifndef GpuProfiler_h
+#define GpuProfiler_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+class Renderer;
+class TraceWriter;
+
+// gpu time spent in one named zone of a finished frame
+class GpuZoneTiming {
+public:
+	std::string name;
+	// relative to the first timestamp written that frame
+	uint64_t startNs = 0;
+	uint64_t durationNs = 0;
+};
+
+// times regions of recorded command buffers with timestamp queries
+// each command buffer slot owns a query pool, read back once the frame using it has finished
+class GpuProfiler {
+public:
+	// each zone writes a begin and an end timestamp
+	static const uint32_t MAX_ZONES = 32;
+	// false when the graphics queue can't write timestamps, zones then record nothing
+	bool enabled = false;
+	std::vector<GpuZoneTiming> lastFrame;
+	// from the first timestamp to the last one of the most recently collected frame
+	double lastFrameMs = 0;
+	uint64_t collectedFrames = 0;
+	// frames whose queries weren't ready when collected, they are skipped rather than waited on
+	uint64_t droppedFrames = 0;
+
+	GpuProfiler();
+	GpuProfiler(Renderer& renderer);
+	void reserve(uint32_t slotCount);
+	// must be called outside a render pass before any zone is recorded into the slot
+	void beginRecording(VkCommandBuffer commandBuffer, uint32_t slot);
+	uint32_t beginZone(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name);
+	void endZone(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t zone);
+	// cpuNs is when the slot's command buffer was submitted, used to place its zones on the trace
+	void submitted(uint32_t slot, uint64_t cpuNs);
+	// reads the slot's last submission without waiting, true if new timings were stored
+	bool collect(uint32_t slot, TraceWriter& trace);
+	void clean();
+
+private:
+	class Slot {
+	public:
+		VkQueryPool pool = VK_NULL_HANDLE;
+		std::vector<std::string> zoneNames;
+		uint64_t submitNs = 0;
+		bool pending = false;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	// nanoseconds per timestamp tick
+	double period = 1.0;
+	uint64_t validMask = ~0ull;
+	std::vector<Slot> slots;
+	std::vector<uint64_t> results;
+};
+
+// times the enclosing scope of a command buffer being recorded
+class GpuZone {
+public:
+	GpuZone(GpuProfiler& profiler, VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name);
+	~GpuZone();
+
+private:
+	GpuProfiler& profiler;
+	VkCommandBuffer commandBuffer;
+	uint32_t slot;
+	uint32_t zone;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "Ktx2File.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef VKX_ZSTD
+#include <zstd.h>
+#endif
+
+// «KTX 20»\r\n\x1A\n
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// the fixed header and the start of the index that follow the identifier, all little endian
+class Ktx2Header {
+public:
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+};
+
+// the supercompression global data's offset and length come next, only BasisLZ uses them
+static const size_t LEVEL_INDEX_OFFSET = sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + 2 * sizeof(uint64_t);
+
+Ktx2File::Ktx2File(const std::string& path) : file(path) {
+	if (file.size < LEVEL_INDEX_OFFSET || memcmp(file.data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		throw std::runtime_error(path + " is not a ktx2 file");
+	Ktx2Header header;
+	memcpy(&header, file.data + sizeof(KTX2_IDENTIFIER), sizeof(header));
+	if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelHeight == 0)
+		throw std::runtime_error(path + " is not a single 2d texture");
+	if (header.vkFormat == VK_FORMAT_UNDEFINED)
+		throw std::runtime_error(path + " needs transcoding to a gpu format, which this build can't do");
+
+	format = (VkFormat)header.vkFormat;
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	supercompression = header.supercompressionScheme;
+	// 0 asks for the mips to be generated, only the base level is stored
+	levelCount = std::max(header.levelCount, 1u);
+
+	if (LEVEL_INDEX_OFFSET + levelCount * 3 * sizeof(uint64_t) > file.size)
+		throw std::runtime_error(path + " has a truncated level index");
+	levels.resize(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++) {
+		uint64_t entry[3];
+		memcpy(entry, file.data + LEVEL_INDEX_OFFSET + i * sizeof(entry), sizeof(entry));
+		levels[i].byteOffset = entry[0];
+		levels[i].byteLength = entry[1];
+		levels[i].uncompressedByteLength = supercompression == SUPERCOMPRESSION_NONE ? entry[1] : entry[2];
+		if (entry[0] + entry[1] > file.size)
+			throw std::runtime_error(path + " has a level past the end of the file");
+	}
+}
+
+VkExtent3D Ktx2File::extent(uint32_t level) {
+	return { std::max(width >> level, 1u), std::max(height >> level, 1u), 1 };
+}
+
+bool Ktx2File::isDecodable() {
+	if (supercompression == SUPERCOMPRESSION_NONE)
+		return true;
+#ifdef VKX_ZSTD
+	if (supercompression == SUPERCOMPRESSION_ZSTD)
+		return true;
+#endif
+	return false;
+}
+
+// scratch is only written when a supercompression scheme is compiled in
+const char* Ktx2File::levelData(uint32_t level, [[maybe_unused]] std::vector<char>& scratch, size_t& size) {
+	const Ktx2Level& entry = levels[level];
+	const char* stored = file.data + entry.byteOffset;
+	if (supercompression == SUPERCOMPRESSION_NONE) {
+		size = (size_t)entry.byteLength;
+		return stored;
+	}
+#ifdef VKX_ZSTD
+	if (supercompression == SUPERCOMPRESSION_ZSTD) {
+		scratch.resize((size_t)entry.uncompressedByteLength);
+		size_t written = ZSTD_decompress(scratch.data(), scratch.size(), stored, (size_t)entry.byteLength);
+		if (ZSTD_isError(written) || written != scratch.size())
+			throw std::runtime_error("failed to decompress ktx2 level");
+		size = written;
+		return scratch.data();
+	}
+#endif
+	throw std::runtime_error("ktx2 supercompression scheme " + std::to_string(supercompression) + " isn't supported by this build");
+}
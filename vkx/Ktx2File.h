@@ -0,0 +1,47 @@
+#ifndef Ktx2File_h
+#define Ktx2File_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// where one mip level lies in a KTX2 file
+class Ktx2Level {
+public:
+	uint64_t byteOffset = 0;
+	uint64_t byteLength = 0;
+	// size once any supercompression is undone
+	uint64_t uncompressedByteLength = 0;
+};
+
+// a memory mapped KTX2 texture, levels are read straight from the mapping
+// only 2D textures with one layer and face are accepted
+class Ktx2File {
+public:
+	static const uint32_t SUPERCOMPRESSION_NONE = 0;
+	static const uint32_t SUPERCOMPRESSION_BASISLZ = 1;
+	static const uint32_t SUPERCOMPRESSION_ZSTD = 2;
+	static const uint32_t SUPERCOMPRESSION_ZLIB = 3;
+	MappedFile file;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levelCount = 0;
+	uint32_t supercompression = SUPERCOMPRESSION_NONE;
+	// indexed by mip level, 0 is the largest
+	std::vector<Ktx2Level> levels;
+
+	Ktx2File(const std::string& path);
+	VkExtent3D extent(uint32_t level);
+	// whether this build can turn the file's levels back into texels
+	bool isDecodable();
+	// the level's texels, decoded into scratch when the file is supercompressed, safe to call from several threads
+	const char* levelData(uint32_t level, std::vector<char>& scratch, size_t& size);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+#include "Renderer.h"
+#include "SwapChainSupport.h"
+
+void LatencyStat::add(double ms) {
+	count++;
+	totalMs += ms;
+	maxMs = std::max(maxMs, ms);
+	lastMs = ms;
+}
+
+double LatencyStat::meanMs() {
+	return count > 0 ? totalMs / count : 0.0;
+}
+
+LatencyTracker::LatencyTracker(Renderer& renderer) : renderer(renderer) {
+	if (renderer.displayTiming) {
+		getPastPresentationTiming = (PFN_vkGetPastPresentationTimingGOOGLE)vkGetDeviceProcAddr(renderer.device, "vkGetPastPresentationTimingGOOGLE");
+		if (getPastPresentationTiming != nullptr)
+			source = LatencySource::DisplayTiming;
+	}
+	else if (renderer.presentWait) {
+		waitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(renderer.device, "vkWaitForPresentKHR");
+		if (waitForPresent != nullptr)
+			source = LatencySource::PresentWait;
+	}
+	// display timing reports CLOCK_MONOTONIC where it exists, which is what steady_clock reads there
+	int64_t monotonicNow = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	monotonicOffset = monotonicNow - (int64_t)TraceWriter::now();
+}
+
+void LatencyTracker::input() {
+	inputEvents++;
+	// the first event waited longest, the frame's latency is measured from it
+	if (nextInputNs == 0)
+		nextInputNs = TraceWriter::now();
+}
+
+void LatencyTracker::beforePresent(VkPresentInfoKHR& presentInfo, uint64_t frame) {
+	frameInputNs = nextInputNs;
+	nextInputNs = 0;
+	presentId = frame + 1;
+	if (source == LatencySource::PresentWait) {
+		presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		presentIdInfo.pNext = presentInfo.pNext;
+		presentIdInfo.swapchainCount = 1;
+		presentIdInfo.pPresentIds = &presentId;
+		presentInfo.pNext = &presentIdInfo;
+	}
+	else if (source == LatencySource::DisplayTiming) {
+		// no desired time, the image goes out as soon as the present mode allows
+		presentTime.presentID = (uint32_t)presentId;
+		presentTime.desiredPresentTime = 0;
+		presentTimesInfo.sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE;
+		presentTimesInfo.pNext = presentInfo.pNext;
+		presentTimesInfo.swapchainCount = 1;
+		presentTimesInfo.pTimes = &presentTime;
+		presentInfo.pNext = &presentTimesInfo;
+	}
+}
+
+void LatencyTracker::afterPresent(uint64_t frame) {
+	Pending present;
+	present.id = frame + 1;
+	present.inputNs = frameInputNs;
+	present.presentNs = TraceWriter::now();
+	if (present.inputNs != 0)
+		inputToPresent.add((present.presentNs - present.inputNs) / 1e6);
+	if (source == LatencySource::None)
+		return;
+	pending.push_back(present);
+	if (pending.size() > MAX_PENDING)
+		pending.pop_front();
+}
+
+void LatencyTracker::collect() {
+	VkSwapchainKHR swapchain = renderer.target.swapchain;
+	if (source == LatencySource::PresentWait) {
+		// a zero timeout only asks, presents complete in order so the first one still out ends the walk
+		while (!pending.empty()) {
+			VkResult result = waitForPresent(renderer.device, swapchain, pending.front().id, 0);
+			if (result == VK_TIMEOUT)
+				break;
+			if (result == VK_SUCCESS)
+				displayed(pending.front(), TraceWriter::now());
+			pending.pop_front();
+		}
+	}
+	else if (source == LatencySource::DisplayTiming) {
+		uint32_t count = 0;
+		if (getPastPresentationTiming(renderer.device, swapchain, &count, nullptr) != VK_SUCCESS || count == 0)
+			return;
+		std::vector<VkPastPresentationTimingGOOGLE> timings(count);
+		if (getPastPresentationTiming(renderer.device, swapchain, &count, timings.data()) != VK_SUCCESS)
+			return;
+		for (uint32_t i = 0; i < count; i++) {
+			// timings arrive in present order, presents skipped over were never shown
+			while (!pending.empty() && (uint32_t)pending.front().id != timings[i].presentID)
+				pending.pop_front();
+			if (pending.empty())
+				break;
+			displayed(pending.front(), (uint64_t)((int64_t)timings[i].actualPresentTime - monotonicOffset));
+			pending.pop_front();
+		}
+	}
+}
+
+void LatencyTracker::swapchainChanged() {
+	pending.clear();
+}
+
+void LatencyTracker::displayed(const Pending& present, uint64_t displayNs) {
+	// a display time from before the present call is clock skew, not a measurement
+	if (displayNs < present.presentNs)
+		displayNs = present.presentNs;
+	presentToDisplay.add((displayNs - present.presentNs) / 1e6);
+	if (present.inputNs == 0)
+		return;
+	inputToDisplay.add((displayNs - present.inputNs) / 1e6);
+	if (renderer.trace.isOpen())
+		renderer.trace.complete("input to display", "latency", TraceWriter::threadTrack(), present.inputNs, displayNs - present.inputNs);
+}
+
+void LatencyTracker::report(std::ostream& out) {
+	const char* sourceName = source == LatencySource::DisplayTiming ? "VK_GOOGLE_display_timing"
+		: source == LatencySource::PresentWait ? "VK_KHR_present_wait" : "cpu timestamps only";
+	out << std::fixed << std::setprecision(2);
+	out << "latency of " << inputEvents << " input events with " << presentPolicyName(renderer.settings.presentPolicy)
+		<< " presentation (" << SwapChainSupport::presentModeName(renderer.target.presentMode) << ", "
+		<< renderer.target.images.size() << " images), display times from " << sourceName << ":\n";
+	LatencyStat* stats[] = { &inputToPresent, &inputToDisplay, &presentToDisplay };
+	const char* names[] = { "input to present", "input to display", "present to display" };
+	for (uint32_t i = 0; i < 3; i++) {
+		if (stats[i]->count == 0)
+			continue;
+		out << "\t" << names[i] << ": " << stats[i]->meanMs() << " ms mean, " << stats[i]->maxMs << " ms max over "
+			<< stats[i]->count << " frames\n";
+	}
+	out << std::defaultfloat;
+}
@@ -0,0 +1,86 @@
+#ifndef LatencyTracker_h
+#define LatencyTracker_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+
+class Renderer;
+
+// where the time a frame reached the display comes from
+enum class LatencySource {
+	// only the cpu side, up to vkQueuePresentKHR, is measured
+	None,
+	// vkWaitForPresentKHR is polled once a frame, so display times can be up to a frame late
+	PresentWait,
+	// the presentation engine reports when each image was shown
+	DisplayTiming
+};
+
+// running totals of one latency measurement
+class LatencyStat {
+public:
+	uint64_t count = 0;
+	double totalMs = 0;
+	double maxMs = 0;
+	double lastMs = 0;
+
+	void add(double ms);
+	double meanMs();
+};
+
+// times input to photons: each frame carries the earliest input event glfwPollEvents delivered since the last frame,
+// which is followed to the frame's vkQueuePresentKHR and, when the device can say, to when the frame was displayed
+// everything is called from the frame loop's thread
+class LatencyTracker {
+public:
+	// presents still waiting for a display time, older ones are given up on
+	static const uint32_t MAX_PENDING = 64;
+	LatencySource source = LatencySource::None;
+	LatencyStat inputToPresent;
+	LatencyStat inputToDisplay;
+	LatencyStat presentToDisplay;
+	uint64_t inputEvents = 0;
+
+	LatencyTracker(Renderer& renderer);
+	// stamps an input event, called by the window's glfw callbacks
+	void input();
+	// chains the frame's present id or timing request onto presentInfo, which must not be reused before the next call
+	void beforePresent(VkPresentInfoKHR& presentInfo, uint64_t frame);
+	void afterPresent(uint64_t frame);
+	// picks up the display times that have come in
+	void collect();
+	// presents to a swapchain that was replaced will never be reported
+	void swapchainChanged();
+	void report(std::ostream& out);
+
+private:
+	class Pending {
+	public:
+		uint64_t id = 0;
+		// 0 when no input arrived for the frame
+		uint64_t inputNs = 0;
+		uint64_t presentNs = 0;
+	};
+
+	Renderer& renderer;
+	PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+	PFN_vkGetPastPresentationTimingGOOGLE getPastPresentationTiming = nullptr;
+	// added to a TraceWriter::now() time to get the presentation engine's monotonic clock
+	int64_t monotonicOffset = 0;
+	uint64_t nextInputNs = 0;
+	uint64_t frameInputNs = 0;
+	std::deque<Pending> pending;
+
+	uint64_t presentId = 0;
+	VkPresentIdKHR presentIdInfo{};
+	VkPresentTimeGOOGLE presentTime{};
+	VkPresentTimesInfoGOOGLE presentTimesInfo{};
+
+	void displayed(const Pending& present, uint64_t displayNs);
+};
+
+#endif
@@ -1,84 +1,140 @@
 #include "LayoutBundle.h"
 
 #include <stdexcept>
+#include <vector>
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
-class LayoutBundle {
-public:
-	VkPipelineLayout layout = VK_NULL_HANDLE;
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-	VkPipelineRasterizationStateCreateInfo rasterizer = {};
-	VkPipelineMultisampleStateCreateInfo multisampling = {};
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-
-	LayoutBundle(Renderer* renderer) {
-
-		LayoutBundle::vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 0;
-		vertexInputInfo.vertexAttributeDescriptionCount = 0;
-
-		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizer.depthClampEnable = VK_FALSE; // forces all vertices in frustrum to be within the acceptable depth range
-		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // wireframe, points, or regular
-		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT; // makes polygons one-sided
-		rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-		rasterizer.depthBiasEnable = VK_FALSE;
-
-		// MSAA config
-		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampling.sampleShadingEnable = VK_FALSE;
-		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-		// color blending. Affects how non-opaque colors are layered
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_TRUE;
-		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		colorBlending.logicOpEnable = VK_FALSE;
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
-
-		// specify an empty pipeline layout
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-		if (vkCreatePipelineLayout(renderer->device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to instantiate PipelineLayout");
-		}
+#include "Renderer.h"
+
+LayoutBundle::LayoutBundle() {}
+
+LayoutBundle::LayoutBundle(Renderer* renderer) {
+
+	LayoutBundle::vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 0;
+	vertexInputInfo.vertexAttributeDescriptionCount = 0;
+	if (renderer->mesh != nullptr) {
+		vertexBinding = Mesh::bindingDescription();
+		Mesh::attributeDescriptions(vertexAttributes);
+		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+		vertexInputInfo.vertexAttributeDescriptionCount = Mesh::ATTRIBUTE_COUNT;
+		vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes;
+	}
+
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE; // forces all vertices in frustrum to be within the acceptable depth range
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // wireframe, points, or regular
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT; // makes polygons one-sided
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	// MSAA config
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = renderer->samples;
+
+	// color blending. Affects how non-opaque colors are layered
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	// after a prepass only the nearest surface's fragments are left to pass, without one draws keep their order on ties
+	bool prepass = renderer->settings.depthPrepass;
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = prepass ? VK_FALSE : VK_TRUE;
+	depthStencil.depthCompareOp = prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+	prepassDepthStencil = depthStencil;
+	prepassDepthStencil.depthWriteEnable = VK_TRUE;
+	prepassDepthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	prepassBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	prepassBlending.attachmentCount = 0;
+
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = sizeof(dynamicStates) / sizeof(VkDynamicState);
+	dynamicState.pDynamicStates = dynamicStates;
+
+	// the uniform ring is always set 0 and the transform hierarchy set 1 when there is one, so the shaders
+	// reading them can name them, followed by the bindless table when there is one
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	uniformSet = (uint32_t)setLayouts.size();
+	setLayouts.push_back(renderer->uniforms.layout);
+	transformSet = (uint32_t)setLayouts.size();
+	if (renderer->transforms != nullptr)
+		setLayouts.push_back(renderer->transforms->layout);
+	bindlessSet = (uint32_t)setLayouts.size();
+	if (renderer->bindless != nullptr)
+		setLayouts.push_back(renderer->bindless->layout);
+
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = PUSH_CONSTANT_SIZE;
+
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = (uint32_t)setLayouts.size();
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(renderer->device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to instantiate PipelineLayout");
 	}
+}
 
-	VkGraphicsPipelineCreateInfo genPipelineInfo(Renderer* renderer) {
-		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = sizeof(renderer->stages);
-		pipelineInfo.pStages = renderer->stages;
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &inputAssembly;
-		pipelineInfo.pRasterizationState = &rasterizer;
-		pipelineInfo.pMultisampleState = &multisampling;
-		pipelineInfo.pDepthStencilState = nullptr; // Optional
-		pipelineInfo.pColorBlendState = &colorBlending;
-		pipelineInfo.layout = layout;
-		pipelineInfo.renderPass = renderer->renderPass;
-		pipelineInfo.subpass = 0;
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-		pipelineInfo.basePipelineIndex = -1; // Optional
-		return pipelineInfo;
+VkGraphicsPipelineCreateInfo LayoutBundle::genPipelineInfo(Renderer* renderer, bool depthOnly) {
+	// the bundle is copied into its Renderer, so re-point at this copy's attachment state
+	colorBlending.pAttachments = &colorBlendAttachment;
+	dynamicState.pDynamicStates = dynamicStates;
+	if (vertexInputInfo.vertexBindingDescriptionCount > 0) {
+		vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+		vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes;
 	}
-};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = (uint32_t)renderer->stages.size();
+	pipelineInfo.pStages = renderer->stages.data();
+	// the vertex stage comes first, a pipeline without a fragment stage only writes depth
+	if (depthOnly)
+		pipelineInfo.stageCount = 1;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = depthOnly ? &prepassDepthStencil : &depthStencil;
+	pipelineInfo.pColorBlendState = depthOnly ? &prepassBlending : &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = layout;
+	pipelineInfo.renderPass = renderer->renderPass;
+	pipelineInfo.subpass = depthOnly ? 0 : renderer->sceneSubpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+	pipelineInfo.basePipelineIndex = -1; // Optional
+	return pipelineInfo;
+}
+
+void LayoutBundle::push(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset) {
+	vkCmdPushConstants(commandBuffer, layout, pushConstantRange.stageFlags, offset, size, data);
+}
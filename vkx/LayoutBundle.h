@@ -4,20 +4,46 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#include "Renderer.h"
+#include "Mesh.h"
+
+class Renderer;
 
 class LayoutBundle {
 public:
-	VkPipelineLayout layout;
+	// per draw data pushed straight into the command buffer, the most every device is guaranteed to take
+	static const uint32_t PUSH_CONSTANT_SIZE = 128;
+	// where the drawn object's index is pushed when there is a transform hierarchy, after a pushed DrawTransform
+	static const uint32_t OBJECT_INDEX_OFFSET = 64;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	// the renderer's mesh layout, unused while the scene is the built in triangle
+	VkVertexInputBindingDescription vertexBinding{};
+	VkVertexInputAttributeDescription vertexAttributes[Mesh::ATTRIBUTE_COUNT]{};
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
 	VkPipelineMultisampleStateCreateInfo multisampling{};
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	// the depth prepass writes depth and no colour
+	VkPipelineDepthStencilStateCreateInfo prepassDepthStencil{};
+	VkPipelineColorBlendStateCreateInfo prepassBlending{};
+	// viewport and scissor are set while recording, so pipelines outlive window resizes
+	VkPipelineViewportStateCreateInfo viewportState{};
+	VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	VkPushConstantRange pushConstantRange{};
+	// indices of the uniform ring's, the transform hierarchy's and the bindless table's sets in layout,
+	// in that order, the last two only there when there are those
+	uint32_t uniformSet = 0;
+	uint32_t transformSet = 0;
+	uint32_t bindlessSet = 0;
+	LayoutBundle();
 	LayoutBundle(Renderer* renderer);
-	VkGraphicsPipelineCreateInfo genPipelineInfo(Renderer* renderer);
+	// depthOnly builds for the prepass subpass from the vertex stage alone
+	VkGraphicsPipelineCreateInfo genPipelineInfo(Renderer* renderer, bool depthOnly = false);
+	void push(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset = 0);
 };
 
 #endif
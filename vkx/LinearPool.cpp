@@ -0,0 +1,58 @@
+#include "LinearPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+LinearPool::LinearPool() {}
+
+LinearPool::LinearPool(Renderer& renderer, VkDeviceSize frameSize, uint32_t frameCount, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+	this->frameSize = frameSize;
+	this->frameCount = std::max(frameCount, 1u);
+	allocator = renderer.allocator;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = frameSize * this->frameCount;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(renderer.device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to create linear pool buffer");
+	memory = allocator->allocateBuffer(buffer, properties);
+}
+
+void LinearPool::beginFrame(uint64_t frame) {
+	frameStart = (frame % frameCount) * frameSize;
+	head = frameStart;
+	flushedHead = frameStart;
+}
+
+LinearAllocation LinearPool::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	LinearAllocation allocation;
+	VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > frameStart + frameSize)
+		return allocation;
+	head = offset + size;
+	peakUsage = std::max(peakUsage, head - frameStart);
+
+	allocation.buffer = buffer;
+	allocation.offset = offset;
+	allocation.size = size;
+	if (memory.mapped != nullptr)
+		allocation.mapped = static_cast<char*>(memory.mapped) + offset;
+	return allocation;
+}
+
+// makes everything written since the last flush visible to the gpu
+void LinearPool::flush() {
+	if (head == flushedHead || memory.mapped == nullptr)
+		return;
+	allocator->flush(memory, flushedHead, head - flushedHead);
+	flushedHead = head;
+}
+
+void LinearPool::clean(Renderer& renderer) {
+	vkDestroyBuffer(renderer.device, buffer, nullptr);
+	allocator->free(memory);
+}
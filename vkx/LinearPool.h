@@ -0,0 +1,46 @@
+#ifndef LinearPool_h
+#define LinearPool_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "MemoryAllocator.h"
+
+// a bump allocated range within a LinearPool's buffer, valid until its frame comes around again
+class LinearAllocation {
+public:
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr;
+};
+
+// one buffer split into a region per frame in flight, each region is bump allocated and reset wholesale
+// for per-frame data such as uniforms and dynamic vertices, which are never freed one by one
+class LinearPool {
+public:
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	VkDeviceSize frameSize = 0;
+	uint32_t frameCount = 0;
+	// high-water mark of any single frame, for sizing the pool
+	VkDeviceSize peakUsage = 0;
+
+	LinearPool();
+	LinearPool(Renderer& renderer, VkDeviceSize frameSize, uint32_t frameCount, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	// only call once the gpu has finished the frame that last used this region
+	void beginFrame(uint64_t frame);
+	// returns an allocation with a null buffer if the frame's region is exhausted
+	LinearAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+	void flush();
+	void clean(Renderer& renderer);
+
+private:
+	VkDeviceSize frameStart = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize flushedHead = 0;
+	MemoryAllocator* allocator = nullptr;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("failed to open file " + path);
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0)
+		return;
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr)
+		data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file " + path);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		throw std::runtime_error("failed to open file " + path);
+	struct stat info;
+	if (fstat(descriptor, &info) != 0) {
+		close(descriptor);
+		throw std::runtime_error("failed to open file " + path);
+	}
+	size = (size_t)info.st_size;
+	if (size > 0) {
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (mapped == MAP_FAILED) {
+			close(descriptor);
+			throw std::runtime_error("failed to map file " + path);
+		}
+		data = static_cast<const char*>(mapped);
+	}
+	// the mapping keeps its own reference to the file
+	close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+	if (data != nullptr)
+		munmap(const_cast<char*>(data), size);
+}
+
+#endif
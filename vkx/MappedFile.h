@@ -0,0 +1,26 @@
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <cstddef>
+#include <string>
+
+// a read-only view of a whole file through the virtual memory system
+// pages are read in by the os as they are first touched, so opening a large file costs nothing up front
+class MappedFile {
+public:
+	const char* data = nullptr;
+	size_t size = 0;
+
+	MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+// index of the smallest power of two multiple of MIN_SIZE that holds size
+static uint32_t orderOf(VkDeviceSize size) {
+	uint32_t order = 0;
+	while ((MemoryAllocator::MIN_SIZE << order) < size)
+		order++;
+	return order;
+}
+
+bool MemoryBlock::allocate(uint32_t order, VkDeviceSize& offset) {
+	uint32_t found = order;
+	while (found < freeRanges.size() && freeRanges[found].empty())
+		found++;
+	if (found >= freeRanges.size())
+		return false;
+
+	offset = *freeRanges[found].begin();
+	freeRanges[found].erase(freeRanges[found].begin());
+	// split the range in halves until it is the requested size, freeing the upper halves
+	while (found > order) {
+		found--;
+		freeRanges[found].insert(offset + (MemoryAllocator::MIN_SIZE << found));
+	}
+	usedOrders[offset] = order;
+	usedBytes += MemoryAllocator::MIN_SIZE << order;
+	return true;
+}
+
+void MemoryBlock::free(VkDeviceSize offset) {
+	auto used = usedOrders.find(offset);
+	if (used == usedOrders.end())
+		throw std::runtime_error("freed memory that was never allocated from this block");
+	uint32_t order = used->second;
+	usedOrders.erase(used);
+	usedBytes -= MemoryAllocator::MIN_SIZE << order;
+
+	// merge with the buddy range for as long as it is free too
+	while (order + 1 < freeRanges.size()) {
+		VkDeviceSize buddy = offset ^ (MemoryAllocator::MIN_SIZE << order);
+		auto free = freeRanges[order].find(buddy);
+		if (free == freeRanges[order].end())
+			break;
+		freeRanges[order].erase(free);
+		offset = std::min(offset, buddy);
+		order++;
+	}
+	freeRanges[order].insert(offset);
+}
+
+VkDeviceSize MemoryBlock::largestFreeRange() {
+	for (size_t order = freeRanges.size(); order > 0; order--) {
+		if (!freeRanges[order - 1].empty())
+			return MemoryAllocator::MIN_SIZE << (order - 1);
+	}
+	return 0;
+}
+
+bool MemoryAllocation::isValid() {
+	return memory != VK_NULL_HANDLE;
+}
+
+MemoryAllocator::MemoryAllocator() {}
+
+MemoryAllocator::MemoryAllocator(Renderer& renderer) {
+	device = renderer.device;
+	blockSize = renderer.settings.memoryBlockSize;
+	vkGetPhysicalDeviceMemoryProperties(renderer.physicalDevice, &memoryProperties);
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	granularity = props.limits.bufferImageGranularity;
+	atomSize = props.limits.nonCoherentAtomSize;
+	allocationLimit = props.limits.maxMemoryAllocationCount;
+	// with a granularity above 1, linear and optimal resources sharing a page would alias, so they get separate blocks
+	pools.resize(memoryProperties.memoryTypeCount * (granularity > 1 ? 2 : 1));
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+	MemoryAllocation allocation;
+	allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+	allocation.pool = allocation.memoryType * (granularity > 1 ? 2 : 1) + (granularity > 1 && linear ? 1 : 0);
+	// buddy ranges are aligned to their own size
+	VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+
+	std::lock_guard<std::mutex> guard(poolLock);
+	VkDeviceSize pooledSize = poolBlockSize(allocation.memoryType);
+	if (size > pooledSize / 2) {
+		// too big to share a block without wasting most of it
+		allocation.memory = allocateMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+		allocation.size = requirements.size;
+		dedicatedAllocations++;
+		dedicatedBytes += requirements.size;
+		liveAllocations++;
+		return allocation;
+	}
+
+	uint32_t order = orderOf(size);
+	std::vector<MemoryBlock*>& pool = pools[allocation.pool];
+	MemoryBlock* block = nullptr;
+	for (auto& candidate : pool) {
+		if (candidate->allocate(order, allocation.offset)) {
+			block = candidate;
+			break;
+		}
+	}
+	if (block == nullptr) {
+		block = new MemoryBlock();
+		block->size = pooledSize;
+		block->freeRanges.resize(orderOf(pooledSize) + 1);
+		block->freeRanges.back().insert(0);
+		try {
+			block->memory = allocateMemory(pooledSize, allocation.memoryType, &block->mapped);
+		}
+		catch (...) {
+			delete block;
+			throw;
+		}
+		pool.push_back(block);
+		block->allocate(order, allocation.offset);
+	}
+
+	allocation.memory = block->memory;
+	allocation.block = block;
+	allocation.size = MIN_SIZE << order;
+	if (block->mapped != nullptr)
+		allocation.mapped = static_cast<char*>(block->mapped) + allocation.offset;
+	liveAllocations++;
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+	MemoryAllocation allocation = allocate(requirements, properties, true);
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image, &requirements);
+	MemoryAllocation allocation = allocate(requirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
+	vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+// each image gets memory of its own, the driver commits lazily allocated memory per allocation
+// and a shared block would be committed as soon as any image in it needed backing
+MemoryAllocation MemoryAllocator::allocateTransientImage(VkImage image) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image, &requirements);
+	uint32_t memoryType = findLazyMemoryType(requirements.memoryTypeBits);
+	// desktop gpus have no lazily allocated memory, the attachment then costs its full size
+	if (memoryType == UINT32_MAX)
+		return allocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	MemoryAllocation allocation;
+	allocation.memoryType = memoryType;
+	allocation.lazy = true;
+	{
+		std::lock_guard<std::mutex> guard(poolLock);
+		allocation.memory = allocateMemory(requirements.size, memoryType, &allocation.mapped);
+		allocation.size = requirements.size;
+		lazyBytes += requirements.size;
+		liveAllocations++;
+	}
+	vkBindImageMemory(device, image, allocation.memory, 0);
+	return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation) {
+	if (!allocation.isValid())
+		return;
+	std::lock_guard<std::mutex> guard(poolLock);
+	liveAllocations--;
+	if (allocation.lazy) {
+		vkFreeMemory(device, allocation.memory, nullptr);
+		deviceAllocations--;
+		lazyBytes -= allocation.size;
+	}
+	else if (allocation.block == nullptr) {
+		vkFreeMemory(device, allocation.memory, nullptr);
+		deviceAllocations--;
+		dedicatedAllocations--;
+		dedicatedBytes -= allocation.size;
+	}
+	else {
+		allocation.block->free(allocation.offset);
+		// keep one empty block per pool around, so a pool emptied and refilled every frame doesn't churn
+		std::vector<MemoryBlock*>& pool = pools[allocation.pool];
+		size_t emptyBlocks = std::count_if(pool.begin(), pool.end(), [](MemoryBlock* block) { return block->usedBytes == 0; });
+		if (allocation.block->usedBytes == 0 && emptyBlocks > 1) {
+			vkFreeMemory(device, allocation.block->memory, nullptr);
+			deviceAllocations--;
+			pool.erase(std::find(pool.begin(), pool.end(), allocation.block));
+			delete allocation.block;
+		}
+	}
+	allocation = MemoryAllocation();
+}
+
+void MemoryAllocator::flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+	if (memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return;
+	VkDeviceSize start = allocation.offset + offset;
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : start + size;
+	VkDeviceSize memorySize = allocation.block != nullptr ? allocation.block->size : allocation.size;
+
+	// flushed ranges must start and end on atom boundaries, or run to the end of the memory
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = start / atomSize * atomSize;
+	end = (end + atomSize - 1) / atomSize * atomSize;
+	range.size = end >= memorySize ? VK_WHOLE_SIZE : end - range.offset;
+	vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+	throw std::runtime_error("no suitable memory type on this device");
+}
+
+uint32_t MemoryAllocator::findLazyMemoryType(uint32_t typeFilter) {
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+			return i;
+	}
+	return UINT32_MAX;
+}
+
+MemoryStats MemoryAllocator::stats() {
+	std::lock_guard<std::mutex> guard(poolLock);
+	MemoryStats stats;
+	stats.dedicatedCount = dedicatedAllocations;
+	stats.allocationCount = liveAllocations;
+	stats.reservedBytes = dedicatedBytes;
+	stats.usedBytes = dedicatedBytes;
+	stats.lazyBytes = lazyBytes;
+	VkDeviceSize freeBytes = 0;
+	for (auto& pool : pools) {
+		for (auto& block : pool) {
+			stats.blockCount++;
+			stats.reservedBytes += block->size;
+			stats.usedBytes += block->usedBytes;
+			freeBytes += block->size - block->usedBytes;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, block->largestFreeRange());
+		}
+	}
+	if (freeBytes > 0)
+		stats.fragmentation = 1.0 - (double)stats.largestFreeRange / freeBytes;
+	return stats;
+}
+
+void MemoryAllocator::clean() {
+	for (auto& pool : pools) {
+		for (auto& block : pool) {
+			vkFreeMemory(device, block->memory, nullptr);
+			delete block;
+		}
+		pool.clear();
+	}
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped) {
+	if (deviceAllocations >= allocationLimit)
+		throw std::runtime_error("device memory allocation limit reached");
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate device memory");
+	deviceAllocations++;
+
+	*mapped = nullptr;
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+			vkFreeMemory(device, memory, nullptr);
+			deviceAllocations--;
+			throw std::runtime_error("failed to map device memory");
+		}
+	}
+	return memory;
+}
+
+// small heaps, like the 256MB host visible window on many discrete cards, get proportionally smaller blocks
+VkDeviceSize MemoryAllocator::poolBlockSize(uint32_t memoryType) {
+	VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+	VkDeviceSize size = MIN_SIZE << orderOf(blockSize);
+	while (size > MIN_SIZE && size > heapSize / 8)
+		size /= 2;
+	return size;
+}
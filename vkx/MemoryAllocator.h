@@ -0,0 +1,109 @@
+#ifndef MemoryAllocator_h
+#define MemoryAllocator_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class Renderer;
+
+// one large VkDeviceMemory carved up by a buddy allocator
+class MemoryBlock {
+public:
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	// persistently mapped when the memory type is host visible
+	void* mapped = nullptr;
+	VkDeviceSize usedBytes = 0;
+	// offsets of free ranges per order, a range of order n spans MIN_SIZE << n bytes
+	std::vector<std::set<VkDeviceSize>> freeRanges;
+	std::unordered_map<VkDeviceSize, uint32_t> usedOrders;
+
+	bool allocate(uint32_t order, VkDeviceSize& offset);
+	void free(VkDeviceSize offset);
+	VkDeviceSize largestFreeRange();
+};
+
+// a sub-range of device memory, owned by whoever asked for it until passed back to free()
+class MemoryAllocation {
+public:
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// points at offset when the memory is host visible, otherwise null
+	void* mapped = nullptr;
+	uint32_t memoryType = 0;
+	uint32_t pool = 0;
+	// null for allocations too large to share a block
+	MemoryBlock* block = nullptr;
+	// lazily allocated memory of its own, committed by the driver only if the attachment ever needs it
+	bool lazy = false;
+
+	bool isValid();
+};
+
+class MemoryStats {
+public:
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	// device memory held, and the part of it handed out
+	VkDeviceSize reservedBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	// lazily allocated transient attachments, which on tiled gpus may never take any memory, left out of the above
+	VkDeviceSize lazyBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	// 0 when all free memory is one contiguous range, towards 1 as it splinters
+	double fragmentation = 0;
+};
+
+// sub-allocates buffers and images from a few large blocks per memory type
+// so the number of vkAllocateMemory calls stays far below maxMemoryAllocationCount
+class MemoryAllocator {
+public:
+	// smallest range handed out, requests are rounded up to a power of two no smaller than this
+	static const VkDeviceSize MIN_SIZE = 256;
+	VkDeviceSize blockSize = 64ull << 20;
+
+	MemoryAllocator();
+	MemoryAllocator(Renderer& renderer);
+	// linear is true for buffers and linear images, false for optimal images
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+	MemoryAllocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+	MemoryAllocation allocateImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+	// for images created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, lazily allocated memory when the device has it,
+	// otherwise ordinary device local memory
+	MemoryAllocation allocateTransientImage(VkImage image);
+	void free(MemoryAllocation& allocation);
+	// writes from the cpu to non-coherent memory must be flushed before the gpu reads them
+	void flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	// UINT32_MAX when none of the types is lazily allocated, as on most desktop gpus
+	uint32_t findLazyMemoryType(uint32_t typeFilter);
+	MemoryStats stats();
+	void clean();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize granularity = 1;
+	VkDeviceSize atomSize = 1;
+	uint32_t allocationLimit = 4096;
+	uint32_t deviceAllocations = 0;
+	uint32_t liveAllocations = 0;
+	uint32_t dedicatedAllocations = 0;
+	VkDeviceSize dedicatedBytes = 0;
+	VkDeviceSize lazyBytes = 0;
+	// blocks per memory type, doubled when buffers and optimal images must be kept apart
+	std::vector<std::vector<MemoryBlock*>> pools;
+	std::mutex poolLock;
+
+	VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+	VkDeviceSize poolBlockSize(uint32_t memoryType);
+};
+
+#endif
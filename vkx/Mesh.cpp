@@ -0,0 +1,73 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "MeshFile.h"
+#include "Renderer.h"
+
+Mesh::Mesh(Renderer& renderer, const std::string& path) {
+	MeshFile file(path);
+	indexType = file.indexType();
+	vertexCount = file.header.vertexCount;
+	indexCount = file.header.indexCount;
+	memcpy(bounds, file.header.bounds, sizeof(bounds));
+
+	vertexBuffer = createBuffer(renderer, file.header.vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, vertexMemory);
+	indexBuffer = createBuffer(renderer, file.header.indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, indexMemory);
+	// pages are faulted in by the copies to staging, the file is never read into memory of our own
+	upload(renderer, vertexBuffer, file.vertexData(), file.header.vertexBytes);
+	token = upload(renderer, indexBuffer, file.indexData(), file.header.indexBytes);
+}
+
+VkVertexInputBindingDescription Mesh::bindingDescription() {
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = sizeof(MeshVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return binding;
+}
+
+void Mesh::attributeDescriptions(VkVertexInputAttributeDescription attributes[ATTRIBUTE_COUNT]) {
+	attributes[0] = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, (uint32_t)offsetof(MeshVertex, position) };
+	attributes[1] = { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, (uint32_t)offsetof(MeshVertex, color) };
+}
+
+void Mesh::bind(VkCommandBuffer commandBuffer) {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+}
+
+void Mesh::clean(Renderer& renderer) {
+	vkDestroyBuffer(renderer.device, vertexBuffer, nullptr);
+	vkDestroyBuffer(renderer.device, indexBuffer, nullptr);
+	if (vertexMemory.isValid())
+		renderer.allocator->free(vertexMemory);
+	if (indexMemory.isValid())
+		renderer.allocator->free(indexMemory);
+}
+
+VkBuffer Mesh::createBuffer(Renderer& renderer, VkDeviceSize size, VkBufferUsageFlags usage, MemoryAllocation& memory) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer;
+	if (vkCreateBuffer(renderer.device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to create mesh buffer");
+	memory = renderer.allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	return buffer;
+}
+
+// payloads larger than the staging ring go in pieces, each a straight copy out of the mapping
+uint64_t Mesh::upload(Renderer& renderer, VkBuffer buffer, const char* data, VkDeviceSize size) {
+	VkDeviceSize chunk = renderer.uploads->stagingSize / 2 / MeshFile::SECTION_ALIGNMENT * MeshFile::SECTION_ALIGNMENT;
+	uint64_t uploadToken = 0;
+	for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+		uploadToken = renderer.uploads->uploadBuffer(buffer, offset, data + offset, std::min(chunk, size - offset));
+	return uploadToken;
+}
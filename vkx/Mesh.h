@@ -0,0 +1,46 @@
+#ifndef Mesh_h
+#define Mesh_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+
+#include "MemoryAllocator.h"
+
+class Renderer;
+
+// a .vkxm mesh in device local vertex and index buffers
+// the file's payloads are copied from the mapping to staging as they are, the mapping is closed once they're queued
+// uploads go ahead of the next frame's submit, so the mesh can be drawn from the frame after it's loaded
+class Mesh {
+public:
+	// binding 0 holds MeshVertex, location 0 is its position and location 1 its color
+	static const uint32_t ATTRIBUTE_COUNT = 2;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	MemoryAllocation vertexMemory;
+	MemoryAllocation indexMemory;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	// bounding sphere, xyz is the centre and w the radius
+	float bounds[4] = {};
+	// the last upload, the buffers are filled once it completes
+	uint64_t token = 0;
+
+	Mesh(Renderer& renderer, const std::string& path);
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	static VkVertexInputBindingDescription bindingDescription();
+	static void attributeDescriptions(VkVertexInputAttributeDescription attributes[ATTRIBUTE_COUNT]);
+	void bind(VkCommandBuffer commandBuffer);
+	// the gpu must be done with the buffers
+	void clean(Renderer& renderer);
+
+private:
+	VkBuffer createBuffer(Renderer& renderer, VkDeviceSize size, VkBufferUsageFlags usage, MemoryAllocation& memory);
+	uint64_t upload(Renderer& renderer, VkBuffer buffer, const char* data, VkDeviceSize size);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+static const char MESH_MAGIC[4] = { 'V', 'K', 'X', 'M' };
+
+static uint64_t alignSection(uint64_t offset) {
+	return (offset + MeshFile::SECTION_ALIGNMENT - 1) / MeshFile::SECTION_ALIGNMENT * MeshFile::SECTION_ALIGNMENT;
+}
+
+static bool inFile(uint64_t offset, uint64_t bytes, size_t size) {
+	return offset % MeshFile::SECTION_ALIGNMENT == 0 && offset <= size && bytes <= size - offset;
+}
+
+// the largest of the index section's indices, read in place from the mapping
+static uint32_t maxIndex(const char* data, uint32_t count, uint32_t size) {
+	uint32_t highest = 0;
+	if (size == 2) {
+		const uint16_t* indices = reinterpret_cast<const uint16_t*>(data);
+		for (uint32_t i = 0; i < count; i++)
+			highest = std::max<uint32_t>(highest, indices[i]);
+	}
+	else {
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(data);
+		for (uint32_t i = 0; i < count; i++)
+			highest = std::max(highest, indices[i]);
+	}
+	return highest;
+}
+
+MeshFile::MeshFile(const std::string& path) : file(path) {
+	if (file.size < sizeof(MeshHeader) || memcmp(file.data, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0)
+		throw std::runtime_error(path + " is not a vkx mesh");
+	memcpy(&header, file.data, sizeof(header));
+	if (header.version != VERSION)
+		throw std::runtime_error(path + " is mesh version " + std::to_string(header.version) + ", expected " + std::to_string(VERSION));
+	if (header.vertexFormat != FORMAT_POSITION_COLOR || header.vertexStride != sizeof(MeshVertex))
+		throw std::runtime_error(path + " has a vertex layout this build can't draw");
+	if (header.indexSize != 2 && header.indexSize != 4)
+		throw std::runtime_error(path + " has an unsupported index size");
+	if (header.vertexCount == 0 || header.indexCount == 0)
+		throw std::runtime_error(path + " has no geometry");
+	// the sizes are checked against the counts and every index against the vertices, so a draw can never read past the buffers
+	if (header.vertexBytes != (uint64_t)header.vertexCount * header.vertexStride || header.indexBytes != (uint64_t)header.indexCount * header.indexSize)
+		throw std::runtime_error(path + " has sections that don't match its counts");
+	if (!inFile(header.vertexOffset, header.vertexBytes, file.size) || !inFile(header.indexOffset, header.indexBytes, file.size))
+		throw std::runtime_error(path + " has a misaligned or truncated section");
+	if (maxIndex(indexData(), header.indexCount, header.indexSize) >= header.vertexCount)
+		throw std::runtime_error(path + " has indices past its last vertex");
+}
+
+VkIndexType MeshFile::indexType() {
+	return header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+const char* MeshFile::vertexData() {
+	return file.data + header.vertexOffset;
+}
+
+const char* MeshFile::indexData() {
+	return file.data + header.indexOffset;
+}
+
+void MeshFile::write(const std::string& path, const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+	MeshHeader header{};
+	memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+	header.version = VERSION;
+	header.vertexFormat = FORMAT_POSITION_COLOR;
+	header.vertexStride = sizeof(MeshVertex);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	// 16 bit indices halve the index buffer whenever every vertex can be reached
+	header.indexSize = vertexCount <= 65536 ? 2 : 4;
+	header.vertexOffset = alignSection(sizeof(MeshHeader));
+	header.vertexBytes = (uint64_t)vertexCount * sizeof(MeshVertex);
+	header.indexOffset = alignSection(header.vertexOffset + header.vertexBytes);
+	header.indexBytes = (uint64_t)indexCount * header.indexSize;
+
+	// a sphere around the bounding box, loose but cheap
+	float low[3] = { INFINITY, INFINITY, INFINITY };
+	float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			low[axis] = std::min(low[axis], vertices[i].position[axis]);
+			high[axis] = std::max(high[axis], vertices[i].position[axis]);
+		}
+	}
+	for (uint32_t axis = 0; axis < 3; axis++)
+		header.bounds[axis] = vertexCount > 0 ? (low[axis] + high[axis]) * 0.5f : 0.0f;
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		float squared = 0.0f;
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			float d = vertices[i].position[axis] - header.bounds[axis];
+			squared += d * d;
+		}
+		header.bounds[3] = std::max(header.bounds[3], std::sqrt(squared));
+	}
+
+	std::vector<char> contents((size_t)(header.indexOffset + header.indexBytes), 0);
+	memcpy(contents.data(), &header, sizeof(header));
+	memcpy(contents.data() + header.vertexOffset, vertices, (size_t)header.vertexBytes);
+	if (header.indexSize == 2) {
+		std::vector<uint16_t> narrow(indices, indices + indexCount);
+		memcpy(contents.data() + header.indexOffset, narrow.data(), (size_t)header.indexBytes);
+	}
+	else
+		memcpy(contents.data() + header.indexOffset, indices, (size_t)header.indexBytes);
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open())
+		throw std::runtime_error("failed to open file " + path);
+	out.write(contents.data(), contents.size());
+	if (!out)
+		throw std::runtime_error("failed to write mesh " + path);
+}
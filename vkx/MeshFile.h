@@ -0,0 +1,60 @@
+#ifndef MeshFile_h
+#define MeshFile_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+
+// one vertex as the vertex buffer holds it, positions are placed like the built in triangle:
+// the unit square around the origin fills one grid cell
+class MeshVertex {
+public:
+	float position[3];
+	float color[3];
+};
+
+// the fixed header at the start of a .vkxm file, all little endian
+// vertex and index payloads follow at 16 byte aligned offsets, already in the layout the gpu reads
+class MeshHeader {
+public:
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexFormat;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// 2 or 4
+	uint32_t indexSize;
+	uint32_t reserved;
+	uint64_t vertexOffset;
+	uint64_t vertexBytes;
+	uint64_t indexOffset;
+	uint64_t indexBytes;
+	// bounding sphere, xyz is the centre and w the radius
+	float bounds[4];
+};
+
+// a memory mapped .vkxm mesh, nothing is parsed beyond the header
+// payloads are handed out as pointers into the mapping and copied straight to staging
+class MeshFile {
+public:
+	static const uint32_t VERSION = 1;
+	static const uint32_t SECTION_ALIGNMENT = 16;
+	// MeshVertex, the only vertex layout so far
+	static const uint32_t FORMAT_POSITION_COLOR = 0;
+	MappedFile file;
+	MeshHeader header;
+
+	MeshFile(const std::string& path);
+	VkIndexType indexType();
+	const char* vertexData();
+	const char* indexData();
+	// lays the payloads out the way the loader wants them, for converters
+	static void write(const std::string& path, const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+};
+
+#endif
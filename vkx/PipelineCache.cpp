@@ -0,0 +1,148 @@
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+// written in front of the driver's blob, which only identifies the device and not the driver build
+class PipelineCacheFileHeader {
+public:
+	char magic[4] = { 'V', 'K', 'X', 'C' };
+	uint32_t formatVersion = 1;
+	uint32_t vendorID = 0;
+	uint32_t deviceID = 0;
+	uint32_t driverVersion = 0;
+	uint8_t uuid[VK_UUID_SIZE] = {};
+	uint64_t dataSize = 0;
+	uint64_t checksum = 0;
+};
+
+// fnv-1a, enough to catch truncated or partially written files
+static uint64_t checksum(const char* data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (uint8_t)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+PipelineCache::PipelineCache() {}
+
+PipelineCache::PipelineCache(Renderer& renderer, const std::vector<char>& file) {
+	device = renderer.device;
+	path = renderer.settings.pipelineCachePath;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+
+	std::vector<char> blob = load(file);
+	warm = !blob.empty();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = blob.size();
+	cacheInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+		// a driver may still reject data it claims to have written, fall back to an empty cache
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		warm = false;
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+			throw std::runtime_error("failed to create pipeline cache");
+	}
+	std::cout << (warm ? "loaded pipeline cache " : "starting with an empty pipeline cache ") << path << "\n";
+}
+
+void PipelineCache::save() {
+	if (path.empty() || cache == VK_NULL_HANDLE)
+		return;
+	size_t size = 0;
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+		return;
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+		return;
+	data.resize(size);
+
+	PipelineCacheFileHeader header;
+	header.vendorID = props.vendorID;
+	header.deviceID = props.deviceID;
+	header.driverVersion = props.driverVersion;
+	memcpy(header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = data.size();
+	header.checksum = checksum(data.data(), data.size());
+
+	// write beside the old file and swap it in, so an interrupted save never leaves a torn cache
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "failed to write pipeline cache " << tempPath << "\n";
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+		std::cerr << "failed to replace pipeline cache " << path << ": " << error.message() << "\n";
+}
+
+void PipelineCache::clean() {
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+std::vector<char> PipelineCache::readFile(const std::string& path) {
+	if (path.empty())
+		return {};
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return {};
+	std::vector<char> contents((size_t)file.tellg());
+	file.seekg(0);
+	file.read(contents.data(), contents.size());
+	if (!file)
+		return {};
+	return contents;
+}
+
+// the driver's blob from a previous run, or nothing if it is missing, corrupt or from another device or driver
+std::vector<char> PipelineCache::load(const std::vector<char>& file) {
+	if (file.size() < sizeof(PipelineCacheFileHeader))
+		return {};
+
+	PipelineCacheFileHeader header;
+	PipelineCacheFileHeader expected;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.formatVersion != expected.formatVersion
+		|| header.vendorID != props.vendorID || header.deviceID != props.deviceID || header.driverVersion != props.driverVersion
+		|| memcmp(header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0
+		|| header.dataSize != file.size() - sizeof(header)) {
+		std::cout << "discarding stale pipeline cache " << path << "\n";
+		return {};
+	}
+
+	std::vector<char> blob(file.begin() + sizeof(header), file.end());
+	if (checksum(blob.data(), blob.size()) != header.checksum || !isCompatible(blob)) {
+		std::cout << "discarding corrupt pipeline cache " << path << "\n";
+		return {};
+	}
+	return blob;
+}
+
+// checks the header vulkan itself puts at the start of the blob
+bool PipelineCache::isCompatible(const std::vector<char>& blob) {
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	if (blob.size() < sizeof(driverHeader))
+		return false;
+	memcpy(&driverHeader, blob.data(), sizeof(driverHeader));
+	return driverHeader.headerSize >= sizeof(driverHeader) && driverHeader.headerSize <= blob.size()
+		&& driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& driverHeader.vendorID == props.vendorID && driverHeader.deviceID == props.deviceID
+		&& memcmp(driverHeader.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
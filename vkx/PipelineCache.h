@@ -0,0 +1,36 @@
+#ifndef PipelineCache_h
+#define PipelineCache_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+class Renderer;
+
+// driver pipeline cache persisted between runs, so warm starts skip most shader compilation
+class PipelineCache {
+public:
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string path;
+	// whether a stored blob was accepted at startup
+	bool warm = false;
+
+	PipelineCache();
+	// file is what readFile returned for the renderer's pipelineCachePath
+	PipelineCache(Renderer& renderer, const std::vector<char>& file);
+	void save();
+	void clean();
+	// the whole file, or nothing when there is none, needs no device so it can be read while one is created
+	static std::vector<char> readFile(const std::string& path);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties props{};
+
+	std::vector<char> load(const std::vector<char>& file);
+	bool isCompatible(const std::vector<char>& blob);
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+PipelineCompiler::PipelineCompiler(Renderer& renderer, uint32_t threadCount) : renderer(renderer) {
+	for (uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+		threads.emplace_back(&PipelineCompiler::work, this);
+}
+
+PipelineCompiler::~PipelineCompiler() {
+	clean();
+}
+
+uint32_t PipelineCompiler::request(const PipelineVariant& variant) {
+	uint32_t handle;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		handle = (uint32_t)builds.size();
+		builds.emplace_back();
+		builds.back().variant = variant;
+		queue.push_back(handle);
+	}
+	wake.notify_one();
+	return handle;
+}
+
+VkPipeline PipelineCompiler::get(uint32_t handle) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (handle >= builds.size())
+		return VK_NULL_HANDLE;
+	return builds[handle].pipeline;
+}
+
+bool PipelineCompiler::failed(uint32_t handle) {
+	std::lock_guard<std::mutex> guard(lock);
+	return handle < builds.size() && builds[handle].failed;
+}
+
+uint32_t PipelineCompiler::pending() {
+	std::lock_guard<std::mutex> guard(lock);
+	return (uint32_t)queue.size() + compiling;
+}
+
+void PipelineCompiler::wait() {
+	std::unique_lock<std::mutex> guard(lock);
+	idle.wait(guard, [this] { return stopping || (queue.empty() && compiling == 0); });
+}
+
+void PipelineCompiler::clean() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (stopping)
+			return;
+		stopping = true;
+		queue.clear();
+	}
+	wake.notify_all();
+	// a build already under way is finished rather than abandoned
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+	for (auto& built : builds) {
+		if (built.pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(renderer.device, built.pipeline, nullptr);
+	}
+	builds.clear();
+	idle.notify_all();
+}
+
+void PipelineCompiler::work() {
+	while (true) {
+		uint32_t handle;
+		PipelineVariant variant;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this] { return stopping || !queue.empty(); });
+			if (stopping)
+				return;
+			handle = queue.front();
+			queue.pop_front();
+			variant = builds[handle].variant;
+			compiling++;
+		}
+
+		CpuZone compileZone(renderer.trace, "compile pipeline");
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		bool buildFailed = false;
+		try {
+			pipeline = build(variant);
+		}
+		catch (const std::exception& e) {
+			// the caller keeps drawing with its fallback, so a bad variant is reported rather than fatal
+			std::cerr << "pipeline variant " << handle << ": " << e.what() << '\n';
+			buildFailed = true;
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		builds[handle].pipeline = pipeline;
+		builds[handle].failed = buildFailed;
+		if (--compiling == 0 && queue.empty())
+			idle.notify_all();
+	}
+}
+
+VkPipeline PipelineCompiler::build(const PipelineVariant& variant) {
+	// the renderer's bundle is only read once it's built, so each build takes a private copy to adjust
+	LayoutBundle bundle = renderer.layoutBundle;
+	bundle.rasterizer.cullMode = variant.cullMode;
+	bundle.rasterizer.polygonMode = variant.polygonMode;
+	bundle.colorBlendAttachment.blendEnable = variant.blend ? VK_TRUE : VK_FALSE;
+
+	// modules are only needed while the pipeline is created
+	ShaderModule* vertex = renderer.loadShader(variant.vertexShaderPath);
+	ShaderModule* fragment = nullptr;
+	try {
+		if (!variant.depthOnly)
+			fragment = renderer.loadShader(variant.fragmentShaderPath);
+	}
+	catch (...) {
+		delete vertex;
+		throw;
+	}
+
+	// same grid layout constant as the default pipeline
+	uint32_t gridSide = renderer.gridSide;
+	VkSpecializationMapEntry gridSideEntry{ 0, 0, sizeof(uint32_t) };
+	VkSpecializationInfo specialization{ 1, &gridSideEntry, sizeof(uint32_t), &gridSide };
+	VkPipelineShaderStageCreateInfo stages[2] = { vertex->shaderCreateInfo(false) };
+	if (fragment != nullptr)
+		stages[1] = fragment->shaderCreateInfo(true);
+	stages[0].pSpecializationInfo = &specialization;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = bundle.genPipelineInfo(&renderer, variant.depthOnly);
+	pipelineInfo.stageCount = fragment != nullptr ? 2 : 1;
+	pipelineInfo.pStages = stages;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateGraphicsPipelines(renderer.device, renderer.pipelineCache.cache, 1, &pipelineInfo, nullptr, &pipeline);
+	delete vertex;
+	delete fragment;
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("failed to create graphics pipeline variant");
+	return pipeline;
+}
@@ -0,0 +1,78 @@
+#ifndef PipelineCompiler_h
+#define PipelineCompiler_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Renderer;
+
+// a graphics pipeline that differs from the renderer's default one in its shaders and some fixed function state
+// everything else, the layout, render pass and dynamic state, comes from the renderer's LayoutBundle
+class PipelineVariant {
+public:
+	std::string vertexShaderPath = "shaders/vert.spv";
+	std::string fragmentShaderPath = "shaders/frag.spv";
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	bool blend = true;
+	// for the depth prepass, built from the vertex shader alone
+	bool depthOnly = false;
+};
+
+// builds pipeline variants on background threads so the frame loop never waits on the shader compiler
+// requests return a handle straight away, the frame loop polls it and draws with a fallback until it is ready
+// pipelines go through the renderer's pipeline cache, which the driver synchronises internally
+class PipelineCompiler {
+public:
+	static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	PipelineCompiler(Renderer& renderer, uint32_t threadCount);
+	~PipelineCompiler();
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+	// queues a variant to be built, safe to call from any thread
+	uint32_t request(const PipelineVariant& variant);
+	// the variant's pipeline once it has been built, otherwise VK_NULL_HANDLE, never blocks on a build
+	VkPipeline get(uint32_t handle);
+	// the build threw, the handle will never become ready
+	bool failed(uint32_t handle);
+	// variants requested but not yet built
+	uint32_t pending();
+	// blocks until every queued variant has been built, for loading screens and benchmarks
+	void wait();
+	// stops the threads, variants still queued are dropped, the gpu must be done with every built pipeline
+	void clean();
+
+private:
+	class Build {
+	public:
+		PipelineVariant variant;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		bool failed = false;
+	};
+
+	Renderer& renderer;
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	// builds are only appended, so a handle is an index and stays valid
+	std::deque<Build> builds;
+	std::deque<uint32_t> queue;
+	// builds taken off the queue and still compiling
+	uint32_t compiling = 0;
+	bool stopping = false;
+
+	void work();
+	VkPipeline build(const PipelineVariant& variant);
+};
+
+#endif
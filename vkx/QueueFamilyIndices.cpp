@@ -1,48 +1,63 @@
 #include "QueueFamilyIndices.h"
 
-#include <optional>
 #include <vector>
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+bool QueueFamilyIndices::isPopulated() {
+	return graphicsFamily.has_value() && (presentFamily.has_value() || !requiresPresent);
+}
 
-class QueueFamilyIndices {
-	public:
-		std::optional<uint32_t> graphicsFamily;
-		std::optional<uint32_t> presentFamily;
-		bool isPopulated() {
-			return graphicsFamily.has_value() && presentFamily.has_value();
-		}
-
-		static QueueFamilyIndices queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface) {
-			QueueFamilyIndices indices;
-
-			uint32_t queueFamilyCount = 0;
-			vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+QueueFamilyIndices QueueFamilyIndices::queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface) {
+	QueueFamilyIndices indices;
+	indices.requiresPresent = surface != VK_NULL_HANDLE;
 
-			std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-			vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
-			int i = 0;
-			for (const auto& queueFamily : queueFamilies) {
-				if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-					indices.graphicsFamily = i;
-				}
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-				VkBool32 presentSupport = false;
-				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-
-				if (presentSupport) {
-					indices.presentFamily = i;
-				}
+	int i = 0;
+	for (const auto& queueFamily : queueFamilies) {
+		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			indices.graphicsFamily = i;
+		}
 
-				if (indices.isPopulated()) {
-					break;
-				}
+		if (indices.requiresPresent) {
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-				i++;
+			if (presentSupport) {
+				indices.presentFamily = i;
 			}
+		}
+
+		if (indices.isPopulated()) {
+			break;
+		}
 
-			return indices;
+		i++;
+	}
+
+	// prefer a transfer-only family, which usually maps to a dedicated copy engine
+	for (uint32_t family = 0; family < queueFamilyCount; family++) {
+		VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+			continue;
+		if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+			indices.transferFamily = family;
+			break;
 		}
-};
+		if (!indices.transferFamily.has_value())
+			indices.transferFamily = family;
+	}
+
+	for (uint32_t family = 0; family < queueFamilyCount; family++) {
+		VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = family;
+			break;
+		}
+	}
+
+	return indices;
+}
@@ -10,6 +10,12 @@ class QueueFamilyIndices {
 public:
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// a family for uploads that isn't the graphics family, empty when the device has none
+	std::optional<uint32_t> transferFamily;
+	// a compute family without graphics, for work that runs alongside rendering, empty when the device has none
+	std::optional<uint32_t> computeFamily;
+	// headless devices have no surface to present to
+	bool requiresPresent = true;
 
 	bool isPopulated();
 	static QueueFamilyIndices queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface);
@@ -1,17 +1,24 @@
 #ifndef RenderGate_h
 #define RenderGate_h
 
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <optional>
+
 class RenderGate {
 public:
 	VkSemaphore imageAvailability;
 	VkSemaphore renderCompleteness;
 	VkFence occupation;
-	VkDevice& device;
+	VkDevice device;
 	std::optional<uint32_t> targetImageIndex;
+	// one past the number of the frame last submitted through this gate, 0 before the first
+	uint64_t frameNumber = 0;
 
 	~RenderGate();
 
-	RenderGate(VkDevice& device);
+	RenderGate(VkDevice device);
 
 };
 
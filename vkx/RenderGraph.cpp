@@ -0,0 +1,473 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+// the parts of an access mask that make the stage's results a later access has to wait for
+static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+GraphUsage GraphUsage::of(GraphAccess access) {
+	GraphUsage usage;
+	VkPipelineStageFlags fragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	switch (access) {
+	case GraphAccess::ColorAttachment:
+		usage.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		usage.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		usage.write = true;
+		usage.attachment = true;
+		break;
+	case GraphAccess::DepthAttachment:
+		usage.stages = fragmentTests;
+		usage.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		usage.write = true;
+		usage.attachment = true;
+		break;
+	case GraphAccess::DepthTest:
+		usage.stages = fragmentTests;
+		usage.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		usage.attachment = true;
+		break;
+	case GraphAccess::Sampled:
+		usage.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		usage.access = VK_ACCESS_SHADER_READ_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		break;
+	case GraphAccess::StorageRead:
+		usage.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		usage.access = VK_ACCESS_SHADER_READ_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_GENERAL;
+		break;
+	case GraphAccess::StorageWrite:
+		usage.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		usage.access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_GENERAL;
+		usage.write = true;
+		break;
+	case GraphAccess::IndirectRead:
+		usage.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		usage.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		break;
+	case GraphAccess::TransferSrc:
+		usage.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		usage.access = VK_ACCESS_TRANSFER_READ_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		break;
+	case GraphAccess::TransferDst:
+		usage.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		usage.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		usage.write = true;
+		break;
+	case GraphAccess::Present:
+		usage.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		usage.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		break;
+	}
+	return usage;
+}
+
+VkImageUsageFlags GraphUsage::imageUsage(GraphAccess access) {
+	switch (access) {
+	case GraphAccess::ColorAttachment:
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case GraphAccess::DepthAttachment:
+	case GraphAccess::DepthTest:
+		return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case GraphAccess::Sampled:
+		return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case GraphAccess::StorageRead:
+	case GraphAccess::StorageWrite:
+		return VK_IMAGE_USAGE_STORAGE_BIT;
+	case GraphAccess::TransferSrc:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case GraphAccess::TransferDst:
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	default:
+		return 0;
+	}
+}
+
+uint32_t RenderGraph::importImage(const std::string& name, VkImageAspectFlags aspect) {
+	Resource resource;
+	resource.name = name;
+	resource.image = true;
+	resource.aspect = aspect;
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::importBuffer(const std::string& name, bool persistent) {
+	Resource resource;
+	resource.name = name;
+	resource.persistent = persistent;
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::createImage(const std::string& name, VkFormat format, VkSampleCountFlagBits samples, VkExtent2D size, VkImageAspectFlags aspect) {
+	Resource resource;
+	resource.name = name;
+	resource.image = true;
+	resource.transient = true;
+	resource.aspect = aspect;
+	resource.format = format;
+	resource.samples = samples;
+	resource.size = size;
+	resources.push_back(resource);
+	return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, bool sideEffects) {
+	Pass pass;
+	pass.name = name;
+	pass.sideEffects = sideEffects;
+	passes.push_back(pass);
+	return (uint32_t)passes.size() - 1;
+}
+
+void RenderGraph::use(uint32_t pass, uint32_t resource, GraphAccess access) {
+	attach(pass, resource, access, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void RenderGraph::attach(uint32_t pass, uint32_t resource, GraphAccess access, VkImageLayout finalLayout) {
+	Use use;
+	use.resource = resource;
+	use.access = access;
+	use.finalLayout = finalLayout;
+	passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::output(uint32_t resource, GraphAccess access) {
+	resources[resource].output = true;
+	resources[resource].outputAccess = access;
+}
+
+void RenderGraph::compile(Renderer& renderer) {
+	cull();
+	for (uint32_t p = 0; p < passes.size(); p++) {
+		if (!passes[p].live)
+			continue;
+		for (auto& use : passes[p].uses) {
+			Resource& resource = resources[use.resource];
+			if (resource.firstPass == INVALID)
+				resource.firstPass = p;
+			resource.lastPass = p;
+		}
+	}
+	allocate(renderer);
+	plan();
+}
+
+void RenderGraph::setImage(uint32_t resource, VkImage image) {
+	resources[resource].handle = image;
+}
+
+VkImage RenderGraph::image(uint32_t resource) {
+	return resources[resource].handle;
+}
+
+VkImageView RenderGraph::view(uint32_t resource) {
+	return resources[resource].view;
+}
+
+bool RenderGraph::begin(VkCommandBuffer commandBuffer, uint32_t pass) {
+	if (pass == INVALID || !passes[pass].live)
+		return false;
+	record(commandBuffer, passes[pass].barrier);
+	return true;
+}
+
+void RenderGraph::end(VkCommandBuffer commandBuffer) {
+	record(commandBuffer, endBarrier);
+}
+
+void RenderGraph::clean(Renderer& renderer) {
+	for (auto& resource : resources) {
+		if (!resource.transient)
+			continue;
+		vkDestroyImageView(renderer.device, resource.view, nullptr);
+		vkDestroyImage(renderer.device, resource.handle, nullptr);
+		renderer.allocator->free(resource.lazyMemory);
+	}
+	for (auto& slot : slots)
+		renderer.allocator->free(slot.memory);
+	resources.clear();
+	passes.clear();
+	slots.clear();
+}
+
+// walks back from the outputs, a pass is kept when something later reads what it writes
+// a kept pass may only write part of a resource, so whatever wrote it before is kept as well
+void RenderGraph::cull() {
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t r = 0; r < resources.size(); r++)
+		needed[r] = resources[r].output;
+	for (size_t p = passes.size(); p-- > 0;) {
+		Pass& pass = passes[p];
+		pass.live = pass.sideEffects;
+		for (auto& use : pass.uses) {
+			if (GraphUsage::of(use.access).write && needed[use.resource])
+				pass.live = true;
+		}
+		if (!pass.live)
+			continue;
+		for (auto& use : pass.uses)
+			needed[use.resource] = true;
+	}
+}
+
+// transients only touched as attachments never leave tile memory on gpus with lazily allocated memory, so they get
+// their own, everything else shares memory with transients used in passes that don't overlap its own
+void RenderGraph::allocate(Renderer& renderer) {
+	std::vector<uint32_t> aliased;
+	std::vector<VkMemoryRequirements> requirements(resources.size());
+	for (uint32_t r = 0; r < resources.size(); r++) {
+		Resource& resource = resources[r];
+		if (!resource.transient || resource.firstPass == INVALID)
+			continue;
+		VkImageUsageFlags usage = 0;
+		bool attachmentOnly = true;
+		for (uint32_t p = resource.firstPass; p <= resource.lastPass; p++) {
+			if (!passes[p].live)
+				continue;
+			for (auto& use : passes[p].uses) {
+				if (use.resource != r)
+					continue;
+				usage |= GraphUsage::imageUsage(use.access);
+				attachmentOnly = attachmentOnly && GraphUsage::of(use.access).attachment;
+			}
+		}
+		if (attachmentOnly)
+			usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.format;
+		imageInfo.extent = { resource.size.width, resource.size.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = resource.samples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(renderer.device, &imageInfo, nullptr, &resource.handle) != VK_SUCCESS)
+			throw std::runtime_error("failed to create transient image " + resource.name);
+		vkGetImageMemoryRequirements(renderer.device, resource.handle, &requirements[r]);
+		transientBytes += requirements[r].size;
+		if (attachmentOnly && renderer.allocator->findLazyMemoryType(requirements[r].memoryTypeBits) != UINT32_MAX)
+			resource.lazyMemory = renderer.allocator->allocateTransientImage(resource.handle);
+		else
+			aliased.push_back(r);
+	}
+
+	// largest first, so the smaller images fill in around them
+	std::stable_sort(aliased.begin(), aliased.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+	for (uint32_t r : aliased) {
+		Resource& resource = resources[r];
+		for (uint32_t s = 0; s < slots.size() && resource.slot == INVALID; s++) {
+			MemorySlot& slot = slots[s];
+			if ((slot.requirements.memoryTypeBits & requirements[r].memoryTypeBits) == 0)
+				continue;
+			bool overlaps = false;
+			for (uint32_t resident : slot.residents)
+				overlaps = overlaps || (resources[resident].firstPass <= resource.lastPass && resource.firstPass <= resources[resident].lastPass);
+			if (overlaps)
+				continue;
+			slot.requirements.size = std::max(slot.requirements.size, requirements[r].size);
+			slot.requirements.alignment = std::max(slot.requirements.alignment, requirements[r].alignment);
+			slot.requirements.memoryTypeBits &= requirements[r].memoryTypeBits;
+			slot.residents.push_back(r);
+			resource.slot = s;
+		}
+		if (resource.slot == INVALID) {
+			MemorySlot slot;
+			slot.requirements = requirements[r];
+			slot.residents.push_back(r);
+			slots.push_back(slot);
+			resource.slot = (uint32_t)slots.size() - 1;
+		}
+	}
+	for (auto& slot : slots) {
+		slot.memory = renderer.allocator->allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+		aliasedBytes += slot.requirements.size;
+		for (uint32_t resident : slot.residents)
+			vkBindImageMemory(renderer.device, resources[resident].handle, slot.memory.memory, slot.memory.offset);
+		// in pass order, each resident takes the memory over from the one before it
+		std::sort(slot.residents.begin(), slot.residents.end(), [this](uint32_t a, uint32_t b) { return resources[a].firstPass < resources[b].firstPass; });
+	}
+
+	for (auto& resource : resources) {
+		if (!resource.transient || resource.handle == VK_NULL_HANDLE)
+			continue;
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.handle;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.format;
+		viewInfo.subresourceRange.aspectMask = resource.aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(renderer.device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+			throw std::runtime_error("failed to create transient image view " + resource.name);
+	}
+}
+
+// a first run finds where every resource stands at the end of a frame, which is where persistent resources
+// start the next one, and where a transient's memory was left by whichever transient held it last
+void RenderGraph::plan() {
+	std::vector<State> ends = simulate(std::vector<State>(resources.size()), false);
+	std::vector<State> starts(resources.size());
+	for (uint32_t r = 0; r < resources.size(); r++) {
+		if (resources[r].persistent)
+			starts[r] = ends[r];
+		// lazily allocated transients are only ever followed by themselves
+		else if (resources[r].transient && resources[r].slot == INVALID) {
+			starts[r] = ends[r];
+			starts[r].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+	for (auto& slot : slots) {
+		size_t count = slot.residents.size();
+		for (size_t i = 0; i < count; i++) {
+			uint32_t resident = slot.residents[i];
+			uint32_t previous = slot.residents[(i + count - 1) % count];
+			// contents never carry over, only the wait for the previous user
+			starts[resident] = ends[previous];
+			starts[resident].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			starts[resident].attachment = starts[resident].attachment && previous == resident;
+		}
+	}
+	simulate(starts, true);
+}
+
+std::vector<RenderGraph::State> RenderGraph::simulate(std::vector<State> states, bool record) {
+	for (auto& pass : passes) {
+		pass.barrier = Barrier();
+		if (!pass.live)
+			continue;
+		for (auto& use : pass.uses)
+			apply(use.resource, states[use.resource], use.access, use.finalLayout, record ? &pass.barrier : nullptr);
+	}
+	endBarrier = Barrier();
+	for (uint32_t r = 0; r < resources.size(); r++) {
+		if (resources[r].output)
+			apply(r, states[r], resources[r].outputAccess, VK_IMAGE_LAYOUT_UNDEFINED, record ? &endBarrier : nullptr);
+	}
+	return states;
+}
+
+// adds what the access needs to wait for to barrier, and moves the resource's state past it
+void RenderGraph::apply(uint32_t resource, State& state, GraphAccess access, VkImageLayout finalLayout, Barrier* barrier) {
+	GraphUsage usage = GraphUsage::of(access);
+	bool image = resources[resource].image;
+	// a render pass transitions its attachments itself, and its external dependencies order them after their last use in one
+	bool transition = image && !usage.attachment && usage.layout != state.layout;
+	bool covered = usage.attachment && state.attachment;
+
+	VkPipelineStageFlags srcStages = 0;
+	VkAccessFlags srcAccess = 0;
+	if (!covered) {
+		if (usage.write || transition) {
+			// reads since the last write already waited for it, so overwriting only has to wait for them
+			if (state.readStages != 0)
+				srcStages = state.readStages;
+			else {
+				srcStages = state.writeStages;
+				srcAccess = state.writeAccess;
+			}
+		}
+		// reads wait once for the last write, later reads by the same stages find it visible already
+		else if (state.writeStages != 0 && usage.access != 0
+			&& ((usage.stages & ~state.visibleStages) != 0 || (usage.access & ~state.visibleAccess) != 0)) {
+			srcStages = state.writeStages;
+			srcAccess = state.writeAccess;
+		}
+	}
+	bool needed = transition || srcStages != 0;
+	if (needed && barrier != nullptr) {
+		barrier->srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		barrier->dstStages |= usage.stages;
+		if (transition) {
+			Transition layoutTransition;
+			layoutTransition.resource = resource;
+			layoutTransition.oldLayout = state.layout;
+			layoutTransition.newLayout = usage.layout;
+			layoutTransition.srcAccess = srcAccess;
+			layoutTransition.dstAccess = usage.access;
+			barrier->transitions.push_back(layoutTransition);
+		}
+		else if (srcAccess != 0) {
+			barrier->srcAccess |= srcAccess;
+			barrier->dstAccess |= usage.access;
+		}
+	}
+
+	if (usage.write) {
+		state.writeStages = usage.stages;
+		state.writeAccess = usage.access & WRITE_ACCESS;
+		state.readStages = 0;
+		state.visibleStages = 0;
+		state.visibleAccess = 0;
+	}
+	// the transition is a write of its own, which this access has already waited for
+	else if (transition) {
+		state.writeStages = usage.stages;
+		state.writeAccess = 0;
+		state.readStages = usage.stages;
+		state.visibleStages = usage.stages;
+		state.visibleAccess = usage.access;
+	}
+	else {
+		state.readStages |= usage.stages;
+		if (needed) {
+			state.visibleStages |= usage.stages;
+			state.visibleAccess |= usage.access;
+		}
+	}
+	if (image) {
+		if (finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+			state.layout = finalLayout;
+		else if (usage.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+			state.layout = usage.layout;
+	}
+	state.attachment = usage.attachment;
+}
+
+void RenderGraph::record(VkCommandBuffer commandBuffer, const Barrier& barrier) {
+	if (barrier.srcStages == 0)
+		return;
+	imageBarriers.clear();
+	for (auto& transition : barrier.transitions) {
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = transition.srcAccess;
+		imageBarrier.dstAccessMask = transition.dstAccess;
+		imageBarrier.oldLayout = transition.oldLayout;
+		imageBarrier.newLayout = transition.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = resources[transition.resource].handle;
+		imageBarrier.subresourceRange.aspectMask = resources[transition.resource].aspect;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		imageBarriers.push_back(imageBarrier);
+	}
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = barrier.srcAccess;
+	memoryBarrier.dstAccessMask = barrier.dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, barrier.srcStages, barrier.dstStages, 0, barrier.srcAccess != 0 ? 1 : 0, &memoryBarrier,
+		0, nullptr, (uint32_t)imageBarriers.size(), imageBarriers.data());
+}
@@ -0,0 +1,174 @@
+#ifndef RenderGraph_h
+#define RenderGraph_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+class Renderer;
+
+// how a pass uses a resource, which decides the barriers and layout transitions placed ahead of it
+enum class GraphAccess {
+	// attachments of a render pass, which loads them from UNDEFINED and so transitions them itself
+	ColorAttachment,
+	DepthAttachment,
+	DepthTest,
+	Sampled,
+	StorageRead,
+	// read and written, as atomics do
+	StorageWrite,
+	IndirectRead,
+	TransferSrc,
+	TransferDst,
+	// handed to the presentation engine, the semaphore waited on by the present orders it
+	Present
+};
+
+// the stages, accesses and layout behind a GraphAccess
+class GraphUsage {
+public:
+	VkPipelineStageFlags stages = 0;
+	VkAccessFlags access = 0;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	bool write = false;
+	bool attachment = false;
+
+	static GraphUsage of(GraphAccess access);
+	static VkImageUsageFlags imageUsage(GraphAccess access);
+};
+
+// the passes of a frame in submission order and the resources they read and write
+// compile() culls passes whose results nobody reads, works out the barriers each remaining pass needs,
+// and creates the transient images, sharing memory between those whose lifetimes don't overlap
+// the frame is recorded by calling begin() for each pass before recording its commands, then end()
+// the graph runs every frame, so persistent and transient resources start a frame where the last one left them
+class RenderGraph {
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+	// bytes of transient images, and the device memory they actually take once aliased
+	VkDeviceSize transientBytes = 0;
+	VkDeviceSize aliasedBytes = 0;
+
+	// an image created elsewhere, set with setImage before each frame, which starts out UNDEFINED
+	uint32_t importImage(const std::string& name, VkImageAspectFlags aspect);
+	// a buffer created elsewhere, persistent when frames share it and its last use has to finish before the next frame's
+	uint32_t importBuffer(const std::string& name, bool persistent);
+	// an image the graph creates and owns, whose contents never outlive the frame
+	uint32_t createImage(const std::string& name, VkFormat format, VkSampleCountFlagBits samples, VkExtent2D size, VkImageAspectFlags aspect);
+	// a pass with side effects outside the graph is never culled
+	uint32_t addPass(const std::string& name, bool sideEffects = false);
+	void use(uint32_t pass, uint32_t resource, GraphAccess access);
+	// an attachment of the pass's render pass, left in finalLayout
+	void attach(uint32_t pass, uint32_t resource, GraphAccess access, VkImageLayout finalLayout);
+	// read after the frame by whatever comes next, which keeps the passes writing it alive
+	void output(uint32_t resource, GraphAccess access);
+	void compile(Renderer& renderer);
+	void setImage(uint32_t resource, VkImage image);
+	VkImage image(uint32_t resource);
+	VkImageView view(uint32_t resource);
+	// records the barriers the pass needs, false when the pass was culled and shouldn't be recorded
+	bool begin(VkCommandBuffer commandBuffer, uint32_t pass);
+	// records the transitions the outputs need
+	void end(VkCommandBuffer commandBuffer);
+	void clean(Renderer& renderer);
+
+private:
+	class Resource {
+	public:
+		std::string name;
+		bool image = false;
+		bool transient = false;
+		bool persistent = false;
+		bool output = false;
+		GraphAccess outputAccess = GraphAccess::Present;
+		VkImageAspectFlags aspect = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		VkExtent2D size{};
+		VkImage handle = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		// live passes using it, INVALID when none do
+		uint32_t firstPass = INVALID;
+		uint32_t lastPass = INVALID;
+		// shared memory of aliased transients, INVALID for lazily allocated ones, which have their own
+		uint32_t slot = INVALID;
+		MemoryAllocation lazyMemory;
+	};
+
+	class Use {
+	public:
+		uint32_t resource = 0;
+		GraphAccess access = GraphAccess::StorageRead;
+		// for attachments, UNDEFINED leaves the layout the access implies
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	class Transition {
+	public:
+		uint32_t resource = 0;
+		VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkAccessFlags srcAccess = 0;
+		VkAccessFlags dstAccess = 0;
+	};
+
+	// everything ahead of a pass goes in one vkCmdPipelineBarrier, hazards without a transition as a global memory barrier
+	class Barrier {
+	public:
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkAccessFlags srcAccess = 0;
+		VkAccessFlags dstAccess = 0;
+		std::vector<Transition> transitions;
+	};
+
+	class Pass {
+	public:
+		std::string name;
+		bool sideEffects = false;
+		bool live = false;
+		std::vector<Use> uses;
+		Barrier barrier;
+	};
+
+	// where a resource stands between passes
+	class State {
+	public:
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		// reads since the last write, and the stages and accesses the write has been made visible to
+		VkPipelineStageFlags readStages = 0;
+		VkPipelineStageFlags visibleStages = 0;
+		VkAccessFlags visibleAccess = 0;
+		// last used as an attachment of a render pass, whose own dependencies order the next such use
+		bool attachment = false;
+	};
+
+	class MemorySlot {
+	public:
+		VkMemoryRequirements requirements{};
+		std::vector<uint32_t> residents;
+		MemoryAllocation memory;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<MemorySlot> slots;
+	Barrier endBarrier;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+
+	void cull();
+	void allocate(Renderer& renderer);
+	void plan();
+	std::vector<State> simulate(std::vector<State> states, bool record);
+	void apply(uint32_t resource, State& state, GraphAccess access, VkImageLayout finalLayout, Barrier* barrier);
+	void record(VkCommandBuffer commandBuffer, const Barrier& barrier);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef RenderSettings_h
+#define RenderSettings_h
+
+#include <cstdint>
+#include <string>
+
+// how each of the scene's draws is handed its own data
+enum class DrawData {
+	None,
+	// a block of the frame's uniform ring, bound with a dynamic offset
+	Uniform,
+	PushConstant
+};
+
+// names as given on the command line, false leaves drawData untouched
+inline bool parseDrawData(const std::string& name, DrawData& drawData) {
+	if (name == "none")
+		drawData = DrawData::None;
+	else if (name == "uniform")
+		drawData = DrawData::Uniform;
+	else if (name == "push")
+		drawData = DrawData::PushConstant;
+	else
+		return false;
+	return true;
+}
+
+inline const char* drawDataName(DrawData drawData) {
+	switch (drawData) {
+	case DrawData::Uniform:
+		return "uniform";
+	case DrawData::PushConstant:
+		return "push";
+	default:
+		return "none";
+	}
+}
+
+// what the swapchain's present mode and image count are picked for, modes the surface lacks fall back to FIFO
+enum class PresentPolicy {
+	// IMMEDIATE, or MAILBOX, with as few images as the surface allows, frames may tear
+	LowLatency,
+	// MAILBOX, or IMMEDIATE, with an image to spare so acquiring rarely waits
+	Throughput,
+	// FIFO_RELAXED, or FIFO, the gpu idles between vertical blanks
+	PowerSaving
+};
+
+// names as given on the command line, false leaves policy untouched
+inline bool parsePresentPolicy(const std::string& name, PresentPolicy& policy) {
+	if (name == "low-latency")
+		policy = PresentPolicy::LowLatency;
+	else if (name == "throughput")
+		policy = PresentPolicy::Throughput;
+	else if (name == "power-saving")
+		policy = PresentPolicy::PowerSaving;
+	else
+		return false;
+	return true;
+}
+
+inline const char* presentPolicyName(PresentPolicy policy) {
+	switch (policy) {
+	case PresentPolicy::LowLatency:
+		return "low-latency";
+	case PresentPolicy::PowerSaving:
+		return "power-saving";
+	default:
+		return "throughput";
+	}
+}
+
+// options chosen by the application before a Renderer is constructed
+class RenderSettings {
+public:
+	// render into a ring of offscreen images instead of a window's swapchain
+	bool headless = false;
+	// default output size of 720p
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	// number of offscreen images rendered to in rotation when headless
+	uint32_t headlessImageCount = 3;
+	// stop after this many frames, 0 renders until the window is closed
+	uint64_t frameLimit = 0;
+	// frames the cpu may record ahead of the gpu, can be changed later with Renderer::setFramesInFlight
+	uint32_t framesInFlight = 2;
+	// pace frames with one timeline semaphore when the device supports it, otherwise with a fence per frame
+	bool timelineSemaphores = true;
+	// can be changed later with Renderer::setPresentPolicy
+	PresentPolicy presentPolicy = PresentPolicy::Throughput;
+	// time input events to their frame's present and, with VK_GOOGLE_display_timing or VK_KHR_present_wait,
+	// to when it reached the display
+	bool measureLatency = false;
+	// scene drawn each frame, the triangles are shared out evenly between the draw calls
+	uint32_t triangleCount = 1;
+	uint32_t drawCount = 1;
+	// per draw data written every frame, which implies recordEachFrame, gpu culled draws are given none
+	// the default shaders are swapped for ones placing each object by the transform it is handed
+	DrawData drawData = DrawData::None;
+	// record fresh commands every frame, otherwise they are recorded once per target image and replayed
+	bool recordEachFrame = true;
+	// record the scene every frame into secondary command buffers on this many threads,
+	// 0 records it on the calling thread
+	uint32_t recordThreads = 0;
+	// samples per pixel of the colour and depth attachments, resolved into the target image within the render pass
+	// lowered to the most the device supports for both
+	uint32_t msaaSamples = 1;
+	// lay the scene's depth down in a depth only subpass first, so the main subpass shades each pixel once,
+	// testing for an EQUAL depth with the same vertex shader, at the cost of transforming every vertex twice
+	bool depthPrepass = false;
+	// cull the draws against the frustum in a compute shader and draw the survivors indirectly
+	bool gpuCulling = false;
+	// cull the draws against the frustum on the cpu every frame and record only the survivors, ignored with gpuCulling
+	bool cpuCulling = false;
+	// threads splitting the cpu cull of large scenes, the recording thread included
+	uint32_t cullThreads = 4;
+	// share of the grid's rows, from the top, inside the culling frustum, objects are laid out row by row
+	// so about this share of them survive, at 1 the frustum is the whole grid and culling rejects nothing
+	float visibleFraction = 1.0f;
+	// parent each draw's object to another in a breadth-first tree with this many children per node, whose world
+	// matrices are updated every frame and replace the objects' own transforms, 0 leaves the objects unparented
+	// the default shaders are swapped for ones placing objects by their world matrix, ignored with gpuCulling
+	uint32_t transformFanout = 0;
+	// nodes of the tree whose local transform changes every frame, dirtying their subtrees
+	uint32_t animatedNodes = 0;
+	// threads updating the tree's larger levels, the recording thread included
+	uint32_t transformThreads = 4;
+	// run compute work such as culling on a separate compute queue when the device has one
+	bool asyncCompute = false;
+	// bind every texture and storage buffer through one update-after-bind descriptor set, bound once per command buffer
+	// instead of a set per draw, needs VK_EXT_descriptor_indexing
+	bool bindless = false;
+	// array sizes of the bindless set, lowered to the device's limits
+	uint32_t bindlessTextures = 4096;
+	uint32_t bindlessBuffers = 4096;
+	// spir-v vertex shader, relative to the working directory
+	std::string vertexShaderPath = "shaders/vert.spv";
+	// .vkxm mesh every instance draws in place of the built in triangle, empty for the triangle
+	// the default vertex shader becomes one that reads the mesh's vertex buffer
+	std::string meshPath;
+	// build the scene's pipeline on a background thread when it uses other shaders than the default pipeline,
+	// frames are drawn with the default pipeline until it is ready, or skip the scene if drawWhileCompiling is off
+	// static command buffers are recorded once, so they turn this off and the pipeline is built before recording
+	bool backgroundPipelines = true;
+	bool drawWhileCompiling = true;
+	uint32_t pipelineThreads = 1;
+	// time command buffer zones with timestamp queries when the device supports them
+	bool profileGpu = true;
+	// chrome trace of cpu and gpu zones, empty to disable
+	std::string tracePath;
+	// print how long each startup step took once the first frame is out, steps also go to the trace
+	bool startupReport = true;
+	// list instance extensions and the like while starting up
+	bool verbose = false;
+	// compiled pipelines kept between runs, empty to always compile from scratch
+	std::string pipelineCachePath = "pipeline.cache";
+	// device memory is reserved in blocks of this size and sub-allocated, smaller heaps get smaller blocks
+	uint64_t memoryBlockSize = 64ull << 20;
+	// uniform data each frame in flight can write, grown to fit a block per draw when drawData is Uniform
+	uint64_t uniformRingSize = 4ull << 20;
+	// host visible ring that uploads are copied through, a single upload can't be larger than this
+	uint64_t stagingSize = 32ull << 20;
+	// device memory streamed texture levels may occupy beyond their mip tails
+	uint64_t textureBudget = 256ull << 20;
+	// threads decoding streamed texture levels and copying them to staging
+	uint32_t streamThreads = 2;
+};
+
+#endif
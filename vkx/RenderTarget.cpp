@@ -1,178 +1,318 @@
 #include "RenderTarget.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
 
+#include "Renderer.h"
 #include "SwapChainSupport.h"
 
-// contains data and settings for a Renderer
-class RenderTarget {
-public:
-	VkSwapchainKHR swapchain;
-	VkFormat format;
-	VkExtent2D size;
-	std::vector<VkImage> images;
-	std::vector<VkImageView> views;
-	VkPipeline pipeline;
-	std::vector<VkFramebuffer> frameBuffers;
-	std::vector<VkCommandBuffer> commandBuffers;
-
-	RenderTarget(Renderer& renderer) {
-		initSwapChain(renderer);
-		initViews(renderer);
-		initPipeline(renderer);
-	}
+RenderTarget::RenderTarget() {}
 
-	void clean(Renderer& parent) {
-		for (auto framebuffer : frameBuffers) {
-			vkDestroyFramebuffer(parent.device, framebuffer, nullptr);
-		}
-		vkDestroyPipeline(parent.device, pipeline, nullptr);
-		for (auto imageView : views) {
-			vkDestroyImageView(parent.device, imageView, nullptr);
+RenderTarget::RenderTarget(Renderer& renderer, VkSwapchainKHR oldSwapchain) {
+	if (renderer.settings.headless)
+		initOffscreenImages(renderer);
+	else
+		initSwapChain(renderer, oldSwapchain);
+	initViews(renderer);
+	initGraph(renderer);
+	createFrameBuffers(renderer);
+	createCommandBuffers(renderer);
+}
+
+void RenderTarget::clean(Renderer& parent) {
+	if (!commandBuffers.empty())
+		vkFreeCommandBuffers(parent.device, parent.commandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
+	for (auto framebuffer : frameBuffers) {
+		vkDestroyFramebuffer(parent.device, framebuffer, nullptr);
+	}
+	for (auto imageView : views) {
+		vkDestroyImageView(parent.device, imageView, nullptr);
+	}
+	graph.clean(parent);
+	if (parent.settings.headless) {
+		for (size_t i = 0; i < images.size(); i++) {
+			vkDestroyImage(parent.device, images[i], nullptr);
+			parent.allocator->free(imageMemory[i]);
 		}
-		vkDestroySwapchainKHR(parent.device, swapchain, nullptr);
 	}
+	else
+		vkDestroySwapchainKHR(parent.device, swapchain, nullptr);
+}
 
-private:
+// passing the swapchain being replaced lets the driver reuse its resources and finish its presents
+void RenderTarget::initSwapChain(Renderer& renderer, VkSwapchainKHR oldSwapchain) {
+	SwapChainSupport swapChainSupport = SwapChainSupport::queryDevice(renderer.physicalDevice, renderer.window.surface);
+	VkSwapchainCreateInfoKHR createInfo = swapChainSupport.buildInfoStruct(renderer, renderer.window, oldSwapchain);
 
-	void initSwapChain(Renderer& renderer) {
-		SwapChainSupport swapChainSupport = SwapChainSupport::queryDevice(renderer.physicalDevice, renderer.window.surface);
-		VkSwapchainCreateInfoKHR createInfo = swapChainSupport.buildInfoStruct(renderer, renderer.window);
+	size = createInfo.imageExtent;
+	format = createInfo.imageFormat;
+	presentMode = createInfo.presentMode;
+	if (vkCreateSwapchainKHR(renderer.device, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Swapchain");
+	uint32_t imageCount = 0;
+	vkGetSwapchainImagesKHR(renderer.device, swapchain, &imageCount, nullptr);
+	images.resize(imageCount);
+	vkGetSwapchainImagesKHR(renderer.device, swapchain, &imageCount, images.data());
+}
 
-		size = createInfo.imageExtent;
-		if (vkCreateSwapchainKHR(renderer.device, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create Swapchain");
-		uint32_t imageCount = 0;
-		vkGetSwapchainImagesKHR(renderer.device, swapchain, &imageCount, nullptr);
-		images.resize(imageCount);
-		vkGetSwapchainImagesKHR(renderer.device, swapchain, &imageCount, images.data());
+// stands in for a swapchain when there is no surface to present to
+void RenderTarget::initOffscreenImages(Renderer& renderer) {
+	swapchain = VK_NULL_HANDLE;
+	format = renderer.targetFormat();
+	size = { renderer.settings.width, renderer.settings.height };
+
+	// every frame in flight needs its own image to write to
+	uint32_t imageCount = std::max(renderer.settings.headlessImageCount, renderer.scheduler.framesInFlight());
+	images.resize(imageCount);
+	imageMemory.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; i++) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { size.width, size.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		// transfer source so finished frames can be copied out for inspection
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(renderer.device, &imageInfo, nullptr, &images[i]) != VK_SUCCESS)
+			throw std::runtime_error("failed to create offscreen image");
+		imageMemory[i] = renderer.allocator->allocateImage(images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	}
+}
 
-	void initViews(Renderer& renderer) {
-		views.resize(images.size());
-		for (size_t i = 0; i < images.size(); i++) {
-			VkImageViewCreateInfo createInfo{};
-			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			createInfo.image = images[i];
-			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			createInfo.format = format;
-			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			createInfo.subresourceRange.baseMipLevel = 0;
-			createInfo.subresourceRange.levelCount = 1;
-			createInfo.subresourceRange.baseArrayLayer = 0;
-			createInfo.subresourceRange.layerCount = 1;
-			if (vkCreateImageView(renderer.device, &createInfo, nullptr, &views[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create image views!");
-			}
+void RenderTarget::initViews(Renderer& renderer) {
+	views.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		VkImageViewCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = images[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = format;
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(renderer.device, &createInfo, nullptr, &views[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create image views!");
 		}
 	}
+}
 
-	void initPipeline(Renderer& renderer) {
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)size.width;
-		viewport.height = (float)size.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = size;
-
-		VkPipelineViewportStateCreateInfo viewportState{};
-		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.viewportCount = 1;
-		viewportState.pViewports = &viewport;
-		viewportState.scissorCount = 1;
-		viewportState.pScissors = &scissor;
-
-		VkDynamicState dynamicStates[]{
-			VK_DYNAMIC_STATE_VIEWPORT
-		};
-
-		VkPipelineDynamicStateCreateInfo dynamicState{};
-		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamicState.dynamicStateCount = sizeof(dynamicStates);
-		dynamicState.pDynamicStates = dynamicStates;
-
-
-		VkGraphicsPipelineCreateInfo pipelineInfo = renderer.genPipelineInfo();
-		pipelineInfo.pViewportState = &viewportState;
-		pipelineInfo.pDynamicState = &dynamicState;
-
-		if (vkCreateGraphicsPipelines(renderer.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create graphics pipeline!");
-		}
+// the frame as the graph sees it: culling writes the draws the main pass reads, which renders into the image
+// transients are sized with the images, so they are rebuilt along with the swapchain
+void RenderTarget::initGraph(Renderer& renderer) {
+	targetImage = graph.importImage("target", VK_IMAGE_ASPECT_COLOR_BIT);
+	depthBuffer = graph.createImage("depth", renderer.depthFormat, renderer.samples, size, VK_IMAGE_ASPECT_DEPTH_BIT);
+	if (renderer.samples != VK_SAMPLE_COUNT_1_BIT)
+		multisampleImage = graph.createImage("multisample", format, renderer.samples, size, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// an async culler's buffers are handed over by semaphore, and it has a set per frame in flight
+	uint32_t drawBuffer = RenderGraph::INVALID;
+	uint32_t countBuffer = RenderGraph::INVALID;
+	if (renderer.culler != nullptr && !renderer.culler->async) {
+		// one set of draw buffers is rewritten every frame, after the last frame's draws have read it
+		drawBuffer = graph.importBuffer("draws", true);
+		countBuffer = graph.importBuffer("draw count", true);
+		clearPass = graph.addPass("clear draw count");
+		graph.use(clearPass, countBuffer, GraphAccess::TransferDst);
+		cullPass = graph.addPass("cull");
+		graph.use(cullPass, countBuffer, GraphAccess::StorageWrite);
+		graph.use(cullPass, drawBuffer, GraphAccess::StorageWrite);
+	}
+
+	mainPass = graph.addPass("main pass");
+	graph.attach(mainPass, targetImage, GraphAccess::ColorAttachment, renderer.targetLayout);
+	graph.attach(mainPass, depthBuffer, GraphAccess::DepthAttachment, renderer.depthLayout);
+	if (multisampleImage != RenderGraph::INVALID)
+		graph.attach(mainPass, multisampleImage, GraphAccess::ColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	if (drawBuffer != RenderGraph::INVALID) {
+		graph.use(mainPass, drawBuffer, GraphAccess::IndirectRead);
+		graph.use(mainPass, countBuffer, GraphAccess::IndirectRead);
 	}
+	graph.output(targetImage, renderer.settings.headless ? GraphAccess::TransferSrc : GraphAccess::Present);
+	graph.compile(renderer);
+}
 
-	void createFrameBuffers(Renderer& renderer) {
-		frameBuffers.resize(views.size());
+void RenderTarget::createFrameBuffers(Renderer& renderer) {
+	frameBuffers.resize(views.size());
 
-		for (size_t i = 0; i < views.size(); i++) {
-			VkImageView attachments[] = { views[i] };
+	for (size_t i = 0; i < views.size(); i++) {
+		// in the render pass's order, the multisampled image last when there is one
+		bool multisampled = multisampleImage != RenderGraph::INVALID;
+		VkImageView attachments[] = { views[i], graph.view(depthBuffer), multisampled ? graph.view(multisampleImage) : VK_NULL_HANDLE };
 
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderer.renderPass;
-			framebufferInfo.attachmentCount = 1;
-			framebufferInfo.pAttachments = attachments;
-			framebufferInfo.width = size.width;
-			framebufferInfo.height = size.height;
-			framebufferInfo.layers = 1;
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderer.renderPass;
+		framebufferInfo.attachmentCount = multisampled ? 3 : 2;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = size.width;
+		framebufferInfo.height = size.height;
+		framebufferInfo.layers = 1;
 
-			if (vkCreateFramebuffer(renderer.device, &framebufferInfo, nullptr, &frameBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to create framebuffer!");
-			}
+		if (vkCreateFramebuffer(renderer.device, &framebufferInfo, nullptr, &frameBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create framebuffer!");
 		}
 	}
+}
 
-	void createCommandBuffers(Renderer& renderer) {
-		commandBuffers.resize(frameBuffers.size());
+void RenderTarget::createCommandBuffers(Renderer& renderer) {
+	// a query pool per frame slot, or per image for static command buffers
+	renderer.profiler.reserve(std::max((uint32_t)frameBuffers.size(), renderer.scheduler.framesInFlight()));
+	// fresh commands are recorded into the frame's own command buffer instead
+	if (renderer.settings.recordEachFrame)
+		return;
+	commandBuffers.resize(frameBuffers.size());
 
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = renderer.commandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = renderer.commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
-		if (vkAllocateCommandBuffers(renderer.device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate command frameBuffers");
+	if (vkAllocateCommandBuffers(renderer.device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate command frameBuffers");
+	}
+
+	for (size_t i = 0; i < commandBuffers.size(); i++) {
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+		beginInfo.pInheritanceInfo = nullptr; // Optional
+
+		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to open command buffer!");
+		}
+		recordCommands(renderer, commandBuffers[i], (uint32_t)i, (uint32_t)i);
+		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record to command buffer!");
 		}
+	}
+}
+
+void RenderTarget::recordCommands(Renderer& renderer, VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t querySlot, const std::vector<VkCommandBuffer>* secondaries) {
+	renderer.profiler.beginRecording(commandBuffer, querySlot);
+	graph.setImage(targetImage, images[imageIndex]);
+	// async culling was submitted to the compute queue ahead of this frame, so the graph has no passes for it
+	if (cullPass != RenderGraph::INVALID) {
+		GpuZone cullZone(renderer.profiler, commandBuffer, querySlot, "cull");
+		if (graph.begin(commandBuffer, clearPass))
+			renderer.culler->recordClear(commandBuffer);
+		if (graph.begin(commandBuffer, cullPass))
+			renderer.culler->recordDispatch(commandBuffer);
+	}
+	graph.begin(commandBuffer, mainPass);
+	uint32_t passZone = renderer.profiler.beginZone(commandBuffer, querySlot, "main pass");
 
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			VkCommandBufferBeginInfo beginInfo{};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-			beginInfo.pInheritanceInfo = nullptr; // Optional
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderer.renderPass;
+	renderPassInfo.framebuffer = frameBuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = size;
 
-			if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-				throw std::runtime_error("failed to open command buffer!");
-			}
+	VkClearValue clearValues[3]{};
+	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	clearValues[2].color = clearValues[0].color;
+	renderPassInfo.clearValueCount = multisampleImage != RenderGraph::INVALID ? 3 : 2;
+	renderPassInfo.pClearValues = clearValues;
+	bool prepass = renderer.settings.depthPrepass;
 
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderer.renderPass;
-			renderPassInfo.framebuffer = frameBuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = size;
-
-			VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = &clearColor;
-
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-			vkCmdEndRenderPass(commandBuffers[i]);
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to record to command buffer!");
+	if (secondaries != nullptr) {
+		// only vkCmdExecuteCommands may be recorded inside the pass, so it is timed as a whole
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		if (prepass) {
+			const std::vector<VkCommandBuffer>& prepassSecondaries = renderer.recorder->prepassCommands();
+			if (!prepassSecondaries.empty())
+				vkCmdExecuteCommands(commandBuffer, (uint32_t)prepassSecondaries.size(), prepassSecondaries.data());
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		}
+		vkCmdExecuteCommands(commandBuffer, (uint32_t)secondaries->size(), secondaries->data());
+	}
+	else {
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		VkPipeline prepassPipeline = VK_NULL_HANDLE;
+		VkPipeline pipeline = renderer.scenePipeline(&prepassPipeline);
+		// the pass still clears while the scene's pipeline compiles
+		if (pipeline != VK_NULL_HANDLE) {
+			// viewport, scissor and descriptor sets carry over from the prepass to the scene's subpass
+			if (renderer.bindless != nullptr)
+				renderer.bindless->bind(commandBuffer, renderer.layoutBundle.layout,
+					VK_PIPELINE_BIND_POINT_GRAPHICS, renderer.layoutBundle.bindlessSet);
+			if (renderer.transforms != nullptr)
+				renderer.transforms->bind(commandBuffer, renderer.layoutBundle.layout, renderer.layoutBundle.transformSet);
+			VkViewport viewport{ 0.0f, 0.0f, (float)size.width, (float)size.height, 0.0f, 1.0f };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			VkRect2D scissor{ { 0, 0 }, size };
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			if (prepassPipeline != VK_NULL_HANDLE) {
+				GpuZone prepassZone(renderer.profiler, commandBuffer, querySlot, "depth prepass");
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prepassPipeline);
+				recordScene(renderer, commandBuffer);
 			}
 		}
+		if (prepass)
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		if (pipeline != VK_NULL_HANDLE) {
+			GpuZone drawZone(renderer.profiler, commandBuffer, querySlot, "scene draws");
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			recordScene(renderer, commandBuffer);
+		}
 	}
+	vkCmdEndRenderPass(commandBuffer);
+	renderer.profiler.endZone(commandBuffer, querySlot, passZone);
+	graph.end(commandBuffer);
+}
+
+// the prepass and the scene's subpass draw the same vertices from the same buffers
+void RenderTarget::recordScene(Renderer& renderer, VkCommandBuffer commandBuffer) {
+	if (renderer.culler != nullptr)
+		renderer.culler->recordDraws(commandBuffer);
+	else
+		recordDraws(renderer, commandBuffer, 0, renderer.scene->visibleCount);
+}
 
-};
+void RenderTarget::recordDraws(Renderer& renderer, VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw) {
+	SceneStore& scene = *renderer.scene;
+	DrawData drawData = renderer.settings.drawData;
+	VkDeviceSize stride = renderer.uniforms.stride(sizeof(DrawTransform));
+
+	// a mesh's buffers are bound per command buffer, secondaries inherit none of the primary's state
+	Mesh* mesh = renderer.mesh;
+	if (mesh != nullptr)
+		mesh->bind(commandBuffer);
+
+	// draws are the visible objects in order, each triangle of an object is one instance
+	for (uint32_t d = firstDraw; d < endDraw; d++) {
+		uint32_t object = scene.visible[d];
+		// objects are the hierarchy's nodes when there is one
+		const DrawTransform& transform = renderer.transforms != nullptr ? renderer.transforms->world[object] : scene.transforms[object];
+		// each draw's block was reserved up front, so workers only copy into their own slots
+		if (drawData == DrawData::Uniform) {
+			VkDeviceSize offset = renderer.drawUniforms.offset + d * stride;
+			memcpy(static_cast<char*>(renderer.drawUniforms.mapped) + d * stride, &transform, sizeof(transform));
+			renderer.uniforms.bind(commandBuffer, renderer.layoutBundle.layout, renderer.layoutBundle.uniformSet, (uint32_t)offset);
+		}
+		else if (drawData == DrawData::PushConstant)
+			renderer.layoutBundle.push(commandBuffer, &transform, sizeof(transform));
+		// the vertex shader reads the object's world matrix from the hierarchy's buffer
+		if (renderer.transforms != nullptr)
+			renderer.layoutBundle.push(commandBuffer, &object, sizeof(object), LayoutBundle::OBJECT_INDEX_OFFSET);
+		if (mesh != nullptr)
+			vkCmdDrawIndexed(commandBuffer, mesh->indexCount, scene.instanceCount[object], 0, 0, scene.firstInstance[object]);
+		else
+			vkCmdDraw(commandBuffer, 3, scene.instanceCount[object], 0, scene.firstInstance[object]);
+	}
+}
@@ -1,22 +1,61 @@
 #ifndef RenderTarget_h
 #define RenderTarget_h
 
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
 #include <vector>
-#include "Renderer.h"
 
+#include "MemoryAllocator.h"
+#include "RenderGraph.h"
+#include "SceneStore.h"
+
+class Renderer;
+
+// contains data and settings for a Renderer
 class RenderTarget {
 public:
-	VkSwapchainKHR swapchain;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	// as the surface allowed them, FIFO when headless
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 	VkFormat format;
 	VkExtent2D size;
 	std::vector<VkImage> images;
+	// backing memory of the offscreen images, empty when presenting to a swapchain
+	std::vector<MemoryAllocation> imageMemory;
 	std::vector<VkImageView> views;
-	VkPipeline pipeline;
+	// the frame's passes, which own the depth buffer and multisampled image, shared by every image
+	RenderGraph graph;
+	uint32_t targetImage = RenderGraph::INVALID;
+	uint32_t depthBuffer = RenderGraph::INVALID;
+	// the scene's samples before they are resolved into the image, invalid without msaa
+	uint32_t multisampleImage = RenderGraph::INVALID;
+	// culling on the graphics queue, invalid when the culler runs on the compute queue or there is none
+	uint32_t clearPass = RenderGraph::INVALID;
+	uint32_t cullPass = RenderGraph::INVALID;
+	uint32_t mainPass = RenderGraph::INVALID;
 	std::vector<VkFramebuffer> frameBuffers;
 	std::vector<VkCommandBuffer> commandBuffers;
 
-	RenderTarget(Renderer& renderer);
+	RenderTarget();
+	RenderTarget(Renderer& renderer, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 	void clean(Renderer& parent);
+	// records the render pass drawing the scene into an open command buffer, inline or by executing secondaries
+	// querySlot is the GpuProfiler slot timing it, the frame slot when recording each frame or else the image
+	void recordCommands(Renderer& renderer, VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t querySlot,
+		const std::vector<VkCommandBuffer>* secondaries = nullptr);
+	// records the scene's draws from firstDraw up to endDraw, its triangles being spread evenly over all draws
+	// safe to call from several threads at once for separate ranges
+	static void recordDraws(Renderer& renderer, VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw);
+
+private:
+	void initSwapChain(Renderer& renderer, VkSwapchainKHR oldSwapchain);
+	void initOffscreenImages(Renderer& renderer);
+	void initViews(Renderer& renderer);
+	void initGraph(Renderer& renderer);
+	void createFrameBuffers(Renderer& renderer);
+	void createCommandBuffers(Renderer& renderer);
+	static void recordScene(Renderer& renderer, VkCommandBuffer commandBuffer);
 };
 
 #endif
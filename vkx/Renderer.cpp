@@ -1,24 +1,44 @@
 #include "Renderer.h"
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
 #include <vector>
 #include <stdexcept>
 #include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 #include <map>
 #include <set>
+#include <future>
 
-#include "ShaderModule.h"
 #include "SwapChainSupport.h"
+#include "ShaderRegistry.h"
 
 
-const int CONCURRENT_RENDER_FRAMES = 2;
-
-// list of necessary vulkan extensions for rendering
+// list of necessary vulkan extensions for rendering to a window
 const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
+// offscreen rendering needs nothing beyond core vulkan
+const std::vector<const char*> headlessDeviceExtensions = {};
+
+// shader the default pipeline is built from when the scene's own is compiled in the background
+const std::string DEFAULT_VERTEX_SHADER = "shaders/vert.spv";
+// stands in for DEFAULT_VERTEX_SHADER when a mesh is drawn, the triangle shader can't read vertex buffers
+const std::string MESH_VERTEX_SHADER = "shaders/mesh.spv";
+// stand in for the two above with a transform hierarchy, placing each object by its world matrix
+const std::string TRANSFORM_VERTEX_SHADER = "shaders/transform.spv";
+const std::string MESH_TRANSFORM_VERTEX_SHADER = "shaders/meshtransform.spv";
+// and with per draw data, placing each object by the transform it was handed
+const std::string UNIFORM_VERTEX_SHADER = "shaders/drawuniform.spv";
+const std::string MESH_UNIFORM_VERTEX_SHADER = "shaders/meshdrawuniform.spv";
+const std::string PUSH_VERTEX_SHADER = "shaders/drawpush.spv";
+const std::string MESH_PUSH_VERTEX_SHADER = "shaders/meshdrawpush.spv";
+// the benchmark's grid shader, swapped like the default one
+const std::string BENCH_VERTEX_SHADER = "shaders/bench.spv";
+
+// format of the offscreen images, which have no surface to negotiate with
+const VkFormat HEADLESS_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
 
 // get the validation layers defined in the Vulkan SDK
 const std::vector<const char*> validationLayers = {
@@ -31,336 +51,332 @@ const bool debugMode = false;
 const bool debugMode = true;
 #endif
 
-class Renderer {
-public:
-	Window window;
-	RenderTarget target;
-	VkInstance instance;
-	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-	VkDevice device;
-	VkQueue graphicsQueue;
-	VkQueue presentQueue;
-	QueueFamilyIndices indices;
-	VkRenderPass renderPass;
-	LayoutBundle layoutBundle;
-	VkPipelineShaderStageCreateInfo* stages;
-	VkCommandPool commandPool;
-	std::vector<VkCommandBuffer> commandBuffers;
-	std::vector<RenderGate*> renderGates;
-	size_t currentFrame = 0;
-	Renderer() {
-		createInstance();
-		registerDevice();
+// the constructor turns off whatever the device can't do, so everything below reads and adjusts the member copy
+Renderer::Renderer(RenderSettings requested) : startup(trace) {
+	settings = requested;
+	// the triangle shader can't read vertex buffers, so a mesh brings its own unless another shader was asked for
+	if (!settings.meshPath.empty() && settings.vertexShaderPath == DEFAULT_VERTEX_SHADER)
+		settings.vertexShaderPath = MESH_VERTEX_SHADER;
+	// gpu culled draws are written by the gpu, there is no per draw recording to attach data to,
+	// nor do they tell the vertex shader which object they are, so it has no node to read
+	if (settings.gpuCulling) {
+		settings.drawData = DrawData::None;
+		settings.transformFanout = 0;
+	}
+	// the built in shaders are swapped for ones reading what each draw is handed, per draw data first,
+	// which carries the object's world matrix when there is a hierarchy
+	bool meshShader = settings.vertexShaderPath == MESH_VERTEX_SHADER;
+	if (meshShader || settings.vertexShaderPath == DEFAULT_VERTEX_SHADER || settings.vertexShaderPath == BENCH_VERTEX_SHADER) {
+		if (settings.drawData == DrawData::Uniform)
+			settings.vertexShaderPath = meshShader ? MESH_UNIFORM_VERTEX_SHADER : UNIFORM_VERTEX_SHADER;
+		else if (settings.drawData == DrawData::PushConstant)
+			settings.vertexShaderPath = meshShader ? MESH_PUSH_VERTEX_SHADER : PUSH_VERTEX_SHADER;
+		else if (settings.transformFanout > 0)
+			settings.vertexShaderPath = meshShader ? MESH_TRANSFORM_VERTEX_SHADER : TRANSFORM_VERTEX_SHADER;
+	}
+	// static command buffers are recorded once, so the scene's pipeline has to exist before they are
+	// rather than building it in the background and giving up static recording
+	if (!settings.recordEachFrame)
+		settings.backgroundPipelines = false;
+	if (!settings.tracePath.empty())
+		trace.open(settings.tracePath);
+
+	// independent steps run side by side, nothing below touches what a running task writes until it is joined
+	// the cache file needs no device, so it is read while one is created
+	std::future<std::vector<char>> cacheFile = std::async(std::launch::async, [this] {
+		StartupPhase phase(startup, "read pipeline cache");
+		return PipelineCache::readFile(settings.pipelineCachePath);
+	});
+	// glfw may only be initialised and open windows on this thread, so the instance is created and the
+	// devices listed on another while the window opens
+	if (!settings.headless)
+		glfwInit();
+	std::future<std::vector<VkPhysicalDevice>> devices = std::async(std::launch::async, [this] {
+		{
+			StartupPhase phase(startup, "create instance");
+			createInstance();
+		}
+		StartupPhase phase(startup, "enumerate devices");
+		return enumerateDevices();
+	});
+	if (!settings.headless) {
+		StartupPhase phase(startup, "open window");
+		window = Window(this);
+	}
+	// devices are judged by their surface support, so the surface must exist first
+	std::vector<VkPhysicalDevice> candidates = devices.get();
+	{
+		StartupPhase phase(startup, "select device");
+		if (!settings.headless)
+			window.createSurface(this);
+		registerDevice(candidates);
+	}
+	{
+		StartupPhase phase(startup, "create device");
 		createLogicalDevice();
-		createRenderGates();
-		initRenderPass();
+	}
+	// shader modules only need the device, so they are created alongside everything up to the pipeline
+	std::future<void> shaders = std::async(std::launch::async, [this] {
+		StartupPhase phase(startup, "load shaders");
 		initShaderStages();
-		createCommandPool();
-		window = Window(this);
-		target = RenderTarget(*this);
+	});
+	{
+		StartupPhase phase(startup, "create device objects");
+		allocator = new MemoryAllocator(*this);
+		uploads = new UploadService(*this);
+		profiler = GpuProfiler(*this);
+		scheduler = FrameScheduler(*this);
+		initRenderPass();
 	}
-	void run() {
-		while (!glfwWindowShouldClose(window.window)) {
-			glfwPollEvents();
-			drawFrame();
-		}
-		vkDeviceWaitIdle(device);
-	}
-	VkGraphicsPipelineCreateInfo genPipelineInfo() {
-		return layoutBundle.genPipelineInfo(this);
-	}
-	~Renderer() {
-		destruct();
-	}
-
-private:
-	void initRenderPass() {
-		VkAttachmentDescription colorAttachment{};
-		SwapChainSupport support = SwapChainSupport::queryDevice(physicalDevice, window.surface);
-
-		colorAttachment.format = support.preferredSurfaceFormat().format;
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		VkAttachmentReference colorAttachmentRef{};
-		colorAttachmentRef.attachment = 0;
-		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		VkSubpassDescription subpass{};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
-
-		VkRenderPassCreateInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.attachmentCount = 1;
-		renderPassInfo.pAttachments = &colorAttachment;
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-
-		if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create render pass!");
+	{
+		StartupPhase phase(startup, "create pipeline cache");
+		pipelineCache = PipelineCache(*this, cacheFile.get());
+	}
+	shaders.get();
+	uniforms = UniformRing(*this, uniformRingSize(), scheduler.framesInFlight());
+	// the table is part of every pipeline layout, so it has to exist before them
+	if (settings.bindless) {
+		if (descriptorIndexing)
+			bindless = new BindlessTable(*this, settings.bindlessTextures, settings.bindlessBuffers);
+		else {
+			std::cout << "bindless descriptors need VK_EXT_descriptor_indexing, binding per draw\n";
+			settings.bindless = false;
 		}
 	}
-	void initShaderStages() {
-		auto vertShaderCode = readFile("shaders/vert.spv");
-		auto fragShaderCode = readFile("shaders/frag.spv");
-		ShaderModule vertShaderModule(vertShaderCode, device);
-		ShaderModule fragShaderModule(fragShaderCode, device);
-
-		VkPipelineShaderStageCreateInfo stages[] = {
-		   vertShaderModule.shaderCreateInfo(false),
-		   fragShaderModule.shaderCreateInfo(true)
-		};
-
-		this->stages = stages;
+	// so is the hierarchy's, its nodes are added with the scene
+	if (settings.transformFanout > 0)
+		transforms = new TransformHierarchy(*this, settings.transformThreads);
+	textures = new TextureStreamer(*this, settings.textureBudget, settings.streamThreads);
+	// pipelines take their vertex input from the mesh, so it has to be loaded before them
+	if (!settings.meshPath.empty()) {
+		StartupPhase phase(startup, "load mesh");
+		mesh = new Mesh(*this, settings.meshPath);
 	}
-	void createRenderGates() {
-		for (size_t i = 0; i < CONCURRENT_RENDER_FRAMES; i++) {
-			renderGates.push_back(new RenderGate(device));
-		}
+	layoutBundle = LayoutBundle(this);
+	{
+		StartupPhase phase(startup, "create default pipeline");
+		initPipeline();
 	}
-	void createCommandPool() {
-		QueueFamilyIndices queueFamilyIndices = QueueFamilyIndices::queryDevice(physicalDevice, window.surface);
-
-		VkCommandPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-
-		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create command pool!");
+	compiler = new PipelineCompiler(*this, settings.pipelineThreads);
+	if (settings.backgroundPipelines && settings.vertexShaderPath != defaultVertexShader()) {
+		PipelineVariant scene;
+		scene.vertexShaderPath = settings.vertexShaderPath;
+		scenePipelineHandle = compiler->request(scene);
+		if (settings.depthPrepass) {
+			scene.depthOnly = true;
+			scenePrepassHandle = compiler->request(scene);
 		}
 	}
-	
-	void createLogicalDevice() {
-		indices = QueueFamilyIndices::queryDevice(physicalDevice, window.surface);
-
-		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-
-		float queuePriority = 1.0f;
-		for (uint32_t queueFamily : uniqueQueueFamilies) {
-			VkDeviceQueueCreateInfo queueCreateInfo{};
-			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			queueCreateInfo.queueFamilyIndex = queueFamily;
-			queueCreateInfo.queueCount = 1;
-			queueCreateInfo.pQueuePriorities = &queuePriority;
-			queueCreateInfos.push_back(queueCreateInfo);
-		}
-
-		VkPhysicalDeviceFeatures deviceFeatures{};
-
-		VkDeviceCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-
-		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-		createInfo.pQueueCreateInfos = queueCreateInfos.data();
-
-		createInfo.pEnabledFeatures = &deviceFeatures;
-
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-
-		if (debugMode) {
-			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-			createInfo.ppEnabledLayerNames = validationLayers.data();
-		}
+	{
+		StartupPhase phase(startup, "build scene");
+		buildScene();
+	}
+	createCommandPool();
+	// compute work is submitted per frame slot, which static command buffers know nothing of
+	if (settings.asyncCompute && indices.computeFamily.has_value()) {
+		settings.recordEachFrame = true;
+		compute = new ComputeQueue(*this);
+	}
+	else
+		settings.asyncCompute = false;
+	if (settings.gpuCulling) {
+		// indirect draws place their triangles on the grid through firstInstance
+		if (enabledFeatures.drawIndirectFirstInstance)
+			culler = new GpuCuller(*this);
 		else {
-			createInfo.enabledLayerCount = 0;
-		}
-
-		if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create logical device!");
+			std::cout << "gpu culling needs drawIndirectFirstInstance, drawing from the cpu\n";
+			settings.gpuCulling = false;
 		}
-
-		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
 	}
-	void registerDevice() {
-		uint32_t deviceCount = 0;
-		vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-		if (deviceCount == 0) {
-			throw std::runtime_error("no gpu in this machine has vulkan support");
-		} else {
-			std::vector<VkPhysicalDevice> devices(deviceCount);
-			vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-			std::vector<VkPhysicalDevice> candidates;
-			for (const auto& device : devices) {
-				// if current device is valid, add to candidates
-				if(isDeviceSuitable(device)) {
-					candidates.push_back(device);
-				}
-			}
-			if(candidates.size() == 0)
-				throw std::runtime_error("no gpu in this machine has required vulkan features");
-		
-			std::multimap<int64_t, VkPhysicalDevice> ratedCandidates;
-			for (const auto& candidate : candidates) {
-				ratedCandidates.insert(std::make_pair(rateDevice(candidate), candidate));
-			}
-			physicalDevice = ratedCandidates.rbegin()->second;
-			std::cout << "vulkan device rating:" << ratedCandidates.rbegin()->first << "\n";
-		}
+	// the gpu's survivors are never seen by the cpu, and what survives changes as the view does
+	if (culler != nullptr)
+		settings.cpuCulling = false;
+	if (settings.cpuCulling)
+		settings.recordEachFrame = true;
+	// per draw data changes every frame, so it can't be baked into static command buffers
+	if (settings.drawData != DrawData::None)
+		settings.recordEachFrame = true;
+	// nor can the offset of the frame's world matrices
+	if (transforms != nullptr)
+		settings.recordEachFrame = true;
+	// secondary buffers are only recorded per frame, and gpu driven draws leave nothing to split between threads
+	if (settings.recordThreads > 0 && culler == nullptr) {
+		settings.recordEachFrame = true;
+		recorder = new CommandRecorder(*this, settings.recordThreads);
 	}
-	int rateDevice(VkPhysicalDevice device) {
-		if(isDeviceSuitable(device) == false)
-			return 0;
-		else {
-			VkPhysicalDeviceProperties props;
-			vkGetPhysicalDeviceProperties(device, &props);
-			int score = 1;
-
-			// max texture size
-			score *= props.limits.maxImageDimension2D + 1;
-
-			switch (props.deviceType) {
-				case VK_PHYSICAL_DEVICE_TYPE_CPU:
-					score *= 1;
-					break;
-				case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
-					score *= 2;
-					break;
-				case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
-					score *= 3;
-					break;
-				case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
-					score *= 4;
-					break;
-				default:
-					score *= 1;
-			}
-
-			return score;
+	if (settings.measureLatency) {
+		if (settings.headless) {
+			std::cout << "latency is measured up to presentation, which headless rendering never does\n";
+			settings.measureLatency = false;
 		}
+		else
+			latency = new LatencyTracker(*this);
 	}
-	bool isDeviceSuitable(VkPhysicalDevice device) {
-		return QueueFamilyIndices::queryDevice(device, window.surface).isPopulated() && isDeviceExtended(device) && SwapChainSupport::queryDevice(device, window.surface).isAdequate();
+	resizeFrames();
+	StartupPhase phase(startup, "create render target");
+	target = RenderTarget(*this);
+}
+
+void Renderer::run() {
+	while (!shouldClose()) {
+		if (!settings.headless)
+			glfwPollEvents();
+		drawFrame();
 	}
-	bool isDeviceExtended(VkPhysicalDevice device) {
-		uint32_t extensionCount;
-		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	vkDeviceWaitIdle(device);
+}
 
-		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+VkGraphicsPipelineCreateInfo Renderer::genPipelineInfo() {
+	return layoutBundle.genPipelineInfo(this);
+}
 
-		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-		for (const auto& extension : availableExtensions) {
-			requiredExtensions.erase(extension.extensionName);
-		}
-		return requiredExtensions.empty();
-	}
-	void createInstance() {
-		ensureValidationSuccess();
-
-		// fill a struct that contains information about the app
-		VkApplicationInfo appInfo{};
-		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-		appInfo.pApplicationName = "Renderer";
-		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.pEngineName = "None";
-		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
-
-		// fill a struct that informs vulkan of glfw's extensions & our app info
-		VkInstanceCreateInfo creationInfo{};
-		creationInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-		creationInfo.pApplicationInfo = &appInfo;
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-		creationInfo.enabledExtensionCount = glfwExtensionCount;
-		creationInfo.ppEnabledExtensionNames = glfwExtensions;
-		if (debugMode) {
-			creationInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-			creationInfo.ppEnabledLayerNames = validationLayers.data();
-		} else {
-			creationInfo.enabledLayerCount = 0;
-		}
-		VkResult result = vkCreateInstance(&creationInfo, nullptr, &instance);
-		if (result == VK_SUCCESS) {
-			std::cout << "created vulkan instance\n";
-		} else {
-			throw std::runtime_error("failed to create vulkan instance. error: " + result);
-		}
+// format of the images that frames are rendered into
+VkFormat Renderer::targetFormat() {
+	if (settings.headless)
+		return HEADLESS_FORMAT;
+	else
+		return SwapChainSupport::queryDevice(physicalDevice, window.surface).preferredSurfaceFormat().format;
+}
 
-		uint32_t extensionCount = 0;
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-		std::vector<VkExtensionProperties> extensions(extensionCount);
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
-		std::cout << "available extensions:\n";
-		for (const auto& extension : extensions) {
-			std::cout << "\t" << extension.extensionName << "\n";
-		}
-	}
-	void ensureValidationSuccess() {
-		if(debugMode) {
-			if(!isValidationAvailable())
-				throw std::runtime_error("vulkan validation layers requested, but aren't available");
-			else
-				std::cout << "vulkan validation is enabled\n";
-		}
+VkPipeline Renderer::scenePipeline(VkPipeline* prepass) {
+	if (prepass != nullptr)
+		*prepass = prepassPipeline;
+	if (scenePipelineHandle == PipelineCompiler::INVALID_HANDLE)
+		return pipeline;
+	// depths laid down by the default shader need not match the scene's, so the two variants are only used together
+	bool hasPrepass = scenePrepassHandle != PipelineCompiler::INVALID_HANDLE;
+	VkPipeline built = compiler->get(scenePipelineHandle);
+	VkPipeline builtPrepass = hasPrepass ? compiler->get(scenePrepassHandle) : VK_NULL_HANDLE;
+	if (built != VK_NULL_HANDLE && (!hasPrepass || builtPrepass != VK_NULL_HANDLE)) {
+		if (prepass != nullptr)
+			*prepass = builtPrepass;
+		return built;
 	}
-	bool isValidationAvailable() {
-		uint32_t layerCount;
-		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+	// a variant that failed to build is never coming, so the default stands in for good
+	bool failed = compiler->failed(scenePipelineHandle) || (hasPrepass && compiler->failed(scenePrepassHandle));
+	if (settings.drawWhileCompiling || failed)
+		return pipeline;
+	return VK_NULL_HANDLE;
+}
 
-		std::vector<VkLayerProperties> availableLayers(layerCount);
-		vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+void Renderer::drawFrame() {
+	CpuZone frameZone(trace, "drawFrame");
+	// the first frame counts towards startup until it has been handed over for presentation
+	uint64_t frameStart = currentFrame == 0 ? TraceWriter::now() : 0;
+	// the gate's semaphores can only be reused once its last frame has finished
+	RenderGate* renderGate;
+	{
+		CpuZone waitZone(trace, "wait for gate");
+		renderGate = scheduler.beginFrame(currentFrame);
+	}
+	// the gate's wait also freed this slot's command pools and buffers
+	uint32_t slot = (uint32_t)(currentFrame % scheduler.framesInFlight());
+	// and that frame's timestamps are complete, so reading them back costs no stall
+	// frames recorded each frame write their slot's query pool, static command buffers their image's
+	if (settings.recordEachFrame)
+		profiler.collect(slot, trace);
+	else if (renderGate->targetImageIndex.has_value())
+		profiler.collect(renderGate->targetImageIndex.value(), trace);
+	releaseRetiredTargets();
+	// the gate's wait also means its slot's uniform region is no longer read
+	uniforms.beginFrame(currentFrame);
+	// and that the slot's descriptor sets and world matrices are no longer read either
+	if (settings.recordEachFrame)
+		frames[slot].descriptors.reset();
+	// the hierarchy implies recordEachFrame, so the slot always has its frame context
+	if (transforms != nullptr) {
+		CpuZone transformZone(trace, "update transforms");
+		animateTransforms();
+		transforms->update(currentFrame, frames[slot].descriptors);
+	}
+	if (bindless != nullptr)
+		bindless->collect(scheduler.completedFrames());
+	textures->update(currentFrame, scheduler.completedFrames());
+	if (latency != nullptr)
+		latency->collect();
 
-		for (const char* layerName : validationLayers) {
-			for (const auto& layerProperties : availableLayers) {
-				if (strcmp(layerName, layerProperties.layerName) == 0) {
-					goto nextLayer;
-				}
-			}
-			return false;
-			nextLayer:
-			continue;
-		}
-		return true;
+	if (settings.headless) {
+		// offscreen images are written in rotation, there is nothing to acquire
+		renderGate->targetImageIndex = (uint32_t)(currentFrame % target.images.size());
 	}
-	void drawFrame() {
-		RenderGate* renderGate = renderGates[currentFrame % CONCURRENT_RENDER_FRAMES];
+	else {
+		CpuZone acquireZone(trace, "acquire");
 		renderGate->targetImageIndex = 0;
 		VkResult result = vkAcquireNextImageKHR(device, target.swapchain, UINT64_MAX, renderGate->imageAvailability, VK_NULL_HANDLE, &renderGate->targetImageIndex.value());
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-			target = RenderTarget(*this);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			// nothing was acquired and the semaphore won't be signalled, so skip this frame
+			rebuildTarget();
+			return;
 		}
-		else if (result != VK_SUCCESS) {
-			throw std::runtime_error("failed to present swap chain image!");
+		// a suboptimal image is still usable, the target is rebuilt after it's presented
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("failed to acquire swap chain image");
 		}
+	}
 
-		for (size_t i = 0; i < renderGates.size(); i++) {
-			if (i == currentFrame % CONCURRENT_RENDER_FRAMES) {
-				if (renderGates[i]->targetImageIndex.has_value() && renderGates[i]->targetImageIndex.value() == renderGate->targetImageIndex.value()) {
-					vkWaitForFences(device, 1, &renderGates[i]->occupation, VK_TRUE, UINT64_MAX);
-				}
-			}
-		}
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	VkSemaphore imageAvailabilityArray[] = { renderGate->imageAvailability };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSemaphore renderCompletenessArray[] = { renderGate->renderCompleteness };
+	if (culler != nullptr)
+		culler->beginFrame(slot);
+	if (compute != nullptr && culler != nullptr && culler->async) {
+		CpuZone computeZone(trace, "async compute");
+		VkCommandBuffer computeBuffer = compute->begin(slot);
+		culler->recordCull(computeBuffer);
+		compute->submit(slot, scheduler, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	}
 
-		VkSemaphore imageAvailabilityArray[] = { renderGate->imageAvailability };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkCommandBuffer commandBuffer;
+	if (settings.recordEachFrame) {
+		CpuZone recordZone(trace, "record");
+		uint32_t imageIndex = renderGate->targetImageIndex.value();
+		if (settings.cpuCulling) {
+			CpuZone cullZone(trace, "cull");
+			scene->cull();
+		}
+		// one reservation for every draw, filled in place while recording
+		if (settings.drawData == DrawData::Uniform) {
+			drawUniforms = uniforms.allocateArray(settings.drawCount, sizeof(DrawTransform));
+			if (drawUniforms.buffer == VK_NULL_HANDLE)
+				throw std::runtime_error("uniform ring is too small for a transform per draw");
+		}
+		const std::vector<VkCommandBuffer>* secondaries = nullptr;
+		// nothing is drawn while the scene's pipeline compiles, so there is nothing to split between threads
+		if (recorder != nullptr && scenePipeline() != VK_NULL_HANDLE)
+			secondaries = &recorder->record(*this, slot, imageIndex);
+		commandBuffer = frames[slot].begin();
+		target.recordCommands(*this, commandBuffer, imageIndex, slot, secondaries);
+		frames[slot].end();
+	}
+	else
+		commandBuffer = target.commandBuffers[renderGate->targetImageIndex.value()];
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	// offscreen frames are never acquired or presented, so there is nothing to wait on or signal
+	if (!settings.headless) {
 		submitInfo.waitSemaphoreCount = 1;
 		submitInfo.pWaitSemaphores = imageAvailabilityArray;
 		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[renderGate->targetImageIndex.value()];
-		VkSemaphore renderCompletenessArray[] = { renderGate->renderCompleteness };
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = renderCompletenessArray;
+	}
 
-		vkResetFences(device, 1, &renderGate->occupation);
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, renderGate->occupation) != VK_SUCCESS)
+	// uploads made since the last frame go ahead of it, so it can read what they wrote
+	uploads->flush();
+	uniforms.flush();
+	VkFence fence = scheduler.prepareSubmit(currentFrame, renderGate, submitInfo);
+	profiler.submitted(settings.recordEachFrame ? slot : renderGate->targetImageIndex.value(), TraceWriter::now());
+	{
+		std::lock_guard<std::mutex> guard(queueLock(graphicsQueue));
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS)
 			throw std::runtime_error("failed to submit draw command buffer to graphics queue");
+	}
 
+	if (!settings.headless) {
+		CpuZone presentZone(trace, "present");
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
@@ -369,34 +385,841 @@ private:
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &renderGate->targetImageIndex.value();
+		if (latency != nullptr)
+			latency->beforePresent(presentInfo, currentFrame);
 
-		vkQueuePresentKHR(presentQueue, &presentInfo);
+		VkResult result;
+		{
+			std::lock_guard<std::mutex> guard(queueLock(presentQueue));
+			result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		}
+		if (latency != nullptr)
+			latency->afterPresent(currentFrame);
+		if (currentFrame == 0)
+			finishStartup(frameStart);
 		currentFrame++;
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.framebufferResized)
+			rebuildTarget();
+		else if (result != VK_SUCCESS)
+			throw std::runtime_error("failed to present swap chain image");
+		return;
+	}
+	if (currentFrame == 0)
+		finishStartup(frameStart);
+	currentFrame++;
+}
+
+void Renderer::finishStartup(uint64_t frameStart) {
+	startup.record("first frame", frameStart, TraceWriter::now() - frameStart);
+	startup.finish();
+	if (settings.startupReport)
+		startup.report(std::cout);
+}
+
+Renderer::~Renderer() {
+	destruct();
+}
+
+void Renderer::setPresentPolicy(PresentPolicy policy) {
+	settings.presentPolicy = policy;
+	if (!settings.headless)
+		rebuildTarget();
+}
+
+// takes effect from the next frame, after the frames already in flight have drained
+void Renderer::setFramesInFlight(uint32_t framesInFlight) {
+	settings.framesInFlight = std::max(framesInFlight, 1u);
+	scheduler.resize(settings.framesInFlight);
+	if (recorder != nullptr)
+		recorder->resize(settings.framesInFlight);
+	if (compute != nullptr)
+		compute->resize(settings.framesInFlight);
+	if (culler != nullptr && culler->async)
+		culler->resize(settings.framesInFlight);
+	resizeFrames();
+	profiler.reserve(settings.framesInFlight);
+	// regions map onto frames by index, and the scheduler has just drained every frame
+	uniforms.clean(*this);
+	uniforms = UniformRing(*this, uniformRingSize(), settings.framesInFlight);
+	if (transforms != nullptr)
+		transforms->resize(*this, settings.framesInFlight);
+	// each headless frame in flight needs an image of its own
+	if (settings.headless && target.images.size() < settings.framesInFlight) {
+		target.clean(*this);
+		target = RenderTarget(*this);
+	}
+}
+
+const std::string& Renderer::defaultVertexShader() {
+	return settings.meshPath.empty() ? DEFAULT_VERTEX_SHADER : MESH_VERTEX_SHADER;
+}
+
+// room for a block per draw on top of the configured size, no alignment is larger than BLOCK_RANGE
+VkDeviceSize Renderer::uniformRingSize() {
+	VkDeviceSize size = settings.uniformRingSize;
+	if (settings.drawData == DrawData::Uniform)
+		size = std::max(size, ((VkDeviceSize)settings.drawCount + 1) * UniformRing::BLOCK_RANGE);
+	return size;
+}
+
+// keeps a FrameContext per frame in flight, the gpu must be idle
+void Renderer::resizeFrames() {
+	uint32_t count = settings.recordEachFrame ? scheduler.framesInFlight() : 0;
+	while (frames.size() > count) {
+		frames.back().clean();
+		frames.pop_back();
+	}
+	while (frames.size() < count)
+		frames.push_back(FrameContext(*this));
+}
+
+// swaps in a target sized to the window, pipelines don't depend on the size and are kept
+void Renderer::rebuildTarget() {
+	CpuZone rebuildZone(trace, "rebuild target");
+	// a minimised window has no size to render at, so wait until it is restored
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window.window, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window.window, &width, &height);
+	}
+	window.framebufferResized = false;
+
+	// frames in flight may still be rendering to the old target, it is destroyed once they are done
+	retiredTargets.push_back(std::make_pair(currentFrame, target));
+	target = RenderTarget(*this, retiredTargets.back().second.swapchain);
+	if (latency != nullptr)
+		latency->swapchainChanged();
+}
+
+void Renderer::releaseRetiredTargets() {
+	// every frame submitted before the target was retired has finished
+	while (!retiredTargets.empty() && scheduler.completedFrames() >= retiredTargets.front().first) {
+		retiredTargets.front().second.clean(*this);
+		retiredTargets.erase(retiredTargets.begin());
+	}
+}
+
+bool Renderer::shouldClose() {
+	if (settings.frameLimit != 0 && currentFrame >= settings.frameLimit)
+		return true;
+	return !settings.headless && glfwWindowShouldClose(window.window);
+}
+
+const std::vector<const char*>& Renderer::requiredDeviceExtensions() {
+	return settings.headless ? headlessDeviceExtensions : deviceExtensions;
+}
+
+// depth formats every device can attach are d16 and one of d24s8 or d32, the most precise one is preferred
+VkFormat Renderer::findDepthFormat() {
+	VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+	for (VkFormat format : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			return format;
 	}
-	void destruct() {
-		std::cout << "destructing App\n";
-		for (auto& renderGate : renderGates) {
-			renderGate->~RenderGate();
+	throw std::runtime_error("failed to find a depth buffer format");
+}
+
+VkSampleCountFlagBits Renderer::chooseSampleCount() {
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	VkSampleCountFlags supported = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+	uint32_t count = 1;
+	for (uint32_t candidate = VK_SAMPLE_COUNT_64_BIT; candidate > 1; candidate >>= 1) {
+		if (candidate <= settings.msaaSamples && (supported & candidate)) {
+			count = candidate;
+			break;
 		}
-		vkDestroyCommandPool(device, commandPool, nullptr);
-		vkDestroyPipelineLayout(device, layoutBundle.layout, nullptr);
-		vkDestroyRenderPass(device, renderPass, nullptr);
-		vkDestroyDevice(device, nullptr);
+	}
+	if (count != std::max(settings.msaaSamples, 1u))
+		std::cout << "msaa lowered from " << settings.msaaSamples << "x to " << count << "x, the most this device supports\n";
+	settings.msaaSamples = count;
+	return (VkSampleCountFlagBits)count;
+}
+
+// an object per draw, each a run of triangles on the grid the vertex shader lays instances out on,
+// bounded by the rectangle of grid cells the run covers
+void Renderer::buildScene() {
+	scene = new SceneStore(settings.cpuCulling ? settings.cullThreads : 1);
+	uint32_t triangles = settings.triangleCount;
+	uint32_t draws = settings.drawCount;
+	uint32_t side = gridSide;
+	float cell = 2.0f / side;
+	// the first triangles % draws draws carry one extra
+	uint32_t base = triangles / draws;
+	uint32_t extra = triangles % draws;
+	// stands in for the per object transforms a real scene would update every frame,
+	// the grid already places every object so they start at the identity
+	DrawTransform transform{};
+	for (uint32_t i = 0; i < 4; i++)
+		transform.matrix[i * 5] = 1.0f;
+
+	scene->reserve(draws);
+	uint32_t firstInstance = 0;
+	for (uint32_t d = 0; d < draws; d++) {
+		uint32_t instances = base + (d < extra ? 1 : 0);
+		uint32_t first = firstInstance;
+		uint32_t last = first + std::max(instances, 1u) - 1;
+		uint32_t firstRow = first / side % side;
+		uint32_t lastRow = last / side % side;
+		// runs spanning several rows cover every column
+		uint32_t firstColumn = lastRow == firstRow ? first % side : 0;
+		uint32_t lastColumn = lastRow == firstRow ? last % side : side - 1;
+		lastRow = std::max(lastRow, firstRow);
+		float halfWidth = (lastColumn - firstColumn + 1) * cell * 0.5f;
+		float halfHeight = (lastRow - firstRow + 1) * cell * 0.5f;
+		float sphere[4] = {
+			firstColumn * cell - 1.0f + halfWidth,
+			firstRow * cell - 1.0f + halfHeight,
+			0.0f,
+			std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight)
+		};
+		scene->add(transform, sphere, firstInstance, instances, 0, 0);
+		firstInstance += instances;
+	}
+	// the lower plane moves up to the edge of the visible share, rows go down the screen as y grows
+	scene->frustum[3][3] = 2.0f * std::clamp(settings.visibleFraction, 0.0f, 1.0f) - 1.0f;
+	if (transforms == nullptr)
+		return;
+
+	// a complete tree numbered level by level, so node d's parent is (d - 1) / fanout
+	// nodes start at the identity like the flat transforms, only the animation moves them
+	transforms->reserve(draws);
+	for (uint32_t d = 0; d < draws; d++) {
+		uint32_t parent = d == 0 ? TransformHierarchy::ROOT : (d - 1) / settings.transformFanout;
+		transforms->add(parent, transform);
+	}
+	transforms->resize(*this, scheduler.framesInFlight());
+}
+
+// stands in for animation, nodes spread over the tree bob up and down, carrying their subtrees with them
+void Renderer::animateTransforms() {
+	uint32_t nodes = transforms->nodeCount();
+	uint32_t animated = std::min(settings.animatedNodes, nodes);
+	for (uint32_t i = 0; i < animated; i++) {
+		uint32_t node = (uint32_t)((uint64_t)nodes * i / animated);
+		DrawTransform transform = transforms->local[node];
+		transform.matrix[13] = 0.01f * std::sin(currentFrame * 0.1f + node);
+		transforms->setLocal(node, transform);
+	}
+}
+
+void Renderer::initRenderPass() {
+	depthFormat = findDepthFormat();
+	samples = chooseSampleCount();
+	bool multisampled = samples != VK_SAMPLE_COUNT_1_BIT;
+	sceneSubpass = settings.depthPrepass ? 1 : 0;
+	VkAttachmentDescription colorAttachment{};
+
+	colorAttachment.format = targetFormat();
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	// a multisampled scene is resolved over the whole image, there is nothing to clear
+	colorAttachment.loadOp = multisampled ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// offscreen frames are left ready to be copied out instead of presented
+	targetLayout = settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = targetLayout;
+
+	// depth is only needed within the pass, so it is never written back to memory
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = samples;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// the samples are only needed until they are resolved at the end of the scene's subpass
+	VkAttachmentDescription multisampleAttachment = colorAttachment;
+	multisampleAttachment.samples = samples;
+	multisampleAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	multisampleAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	multisampleAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = multisampled ? 2 : 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	VkAttachmentReference resolveAttachmentRef{};
+	resolveAttachmentRef.attachment = 0;
+	resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// after a prepass the scene only tests against depth, which it can do from a read only layout
+	VkAttachmentReference sceneDepthRef = depthAttachmentRef;
+	if (settings.depthPrepass)
+		sceneDepthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthLayout = sceneDepthRef.layout;
+	depthAttachment.finalLayout = depthLayout;
+
+	VkSubpassDescription subpasses[2]{};
+	VkSubpassDescription& prepass = subpasses[0];
+	prepass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	prepass.pDepthStencilAttachment = &depthAttachmentRef;
+	VkSubpassDescription& subpass = subpasses[sceneSubpass];
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
+	subpass.pDepthStencilAttachment = &sceneDepthRef;
+
+	// one depth buffer and multisampled image serve every frame in flight, so each frame's writes wait for the last frame's
+	// the target image is acquired by the time COLOR_ATTACHMENT_OUTPUT is reached, where the submit waits for it
+	VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	std::vector<VkSubpassDependency> dependencies;
+	VkSubpassDependency depthDependency{};
+	depthDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	depthDependency.dstSubpass = 0;
+	depthDependency.srcStageMask = depthStages;
+	depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthDependency.dstStageMask = depthStages;
+	depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	VkSubpassDependency colorDependency{};
+	colorDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	colorDependency.dstSubpass = sceneSubpass;
+	colorDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	colorDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	colorDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	colorDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	if (settings.depthPrepass) {
+		dependencies.push_back(depthDependency);
+		dependencies.push_back(colorDependency);
+		// the scene's tests read the depth the prepass wrote, pixel by pixel
+		VkSubpassDependency prepassDependency{};
+		prepassDependency.srcSubpass = 0;
+		prepassDependency.dstSubpass = 1;
+		prepassDependency.srcStageMask = depthStages;
+		prepassDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		prepassDependency.dstStageMask = depthStages;
+		prepassDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		prepassDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		dependencies.push_back(prepassDependency);
+	}
+	else {
+		depthDependency.srcStageMask |= colorDependency.srcStageMask;
+		depthDependency.srcAccessMask |= colorDependency.srcAccessMask;
+		depthDependency.dstStageMask |= colorDependency.dstStageMask;
+		depthDependency.dstAccessMask |= colorDependency.dstAccessMask;
+		dependencies.push_back(depthDependency);
+	}
+
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, multisampleAttachment };
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = multisampled ? 3 : 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = sceneSubpass + 1;
+	renderPassInfo.pSubpasses = subpasses;
+	renderPassInfo.dependencyCount = (uint32_t)dependencies.size();
+	renderPassInfo.pDependencies = dependencies.data();
+
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create render pass!");
+	}
+}
+
+void Renderer::initShaderStages() {
+	// modules must outlive every pipeline built from these stages
+	// a scene shader compiled in the background leaves the default pipeline with the default shader
+	bool background = settings.backgroundPipelines && settings.vertexShaderPath != defaultVertexShader();
+	shaderModules.push_back(loadShader(background ? defaultVertexShader() : settings.vertexShaderPath));
+	shaderModules.push_back(loadShader("shaders/frag.spv"));
+
+	// constant 0 lays instanced triangles out on a grid, shaders that don't declare it ignore it
+	gridSide = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)settings.triangleCount)));
+	gridSideEntry.constantID = 0;
+	gridSideEntry.offset = 0;
+	gridSideEntry.size = sizeof(uint32_t);
+	specialization.mapEntryCount = 1;
+	specialization.pMapEntries = &gridSideEntry;
+	specialization.dataSize = sizeof(uint32_t);
+	specialization.pData = &gridSide;
+
+	stages = {
+		shaderModules[0]->shaderCreateInfo(false),
+		shaderModules[1]->shaderCreateInfo(true)
+	};
+	stages[0].pSpecializationInfo = &specialization;
+}
+
+void Renderer::initPipeline() {
+	VkGraphicsPipelineCreateInfo pipelineInfo = genPipelineInfo();
+	if (vkCreateGraphicsPipelines(device, pipelineCache.cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+	if (settings.depthPrepass) {
+		VkGraphicsPipelineCreateInfo prepassInfo = layoutBundle.genPipelineInfo(this, true);
+		if (vkCreateGraphicsPipelines(device, pipelineCache.cache, 1, &prepassInfo, nullptr, &prepassPipeline) != VK_SUCCESS)
+			throw std::runtime_error("failed to create depth prepass pipeline");
+	}
+}
+
+void Renderer::createCommandPool() {
+	QueueFamilyIndices queueFamilyIndices = QueueFamilyIndices::queryDevice(physicalDevice, window.surface);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create command pool!");
+	}
+}
+
+void Renderer::createLogicalDevice() {
+	indices = QueueFamilyIndices::queryDevice(physicalDevice, window.surface);
+
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value() };
+	if (indices.presentFamily.has_value())
+		uniqueQueueFamilies.insert(indices.presentFamily.value());
+	if (indices.transferFamily.has_value())
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	if (indices.computeFamily.has_value())
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
+
+	// uploads may submit from any thread, so when compute shares their family it gets a queue of its own if there is one
+	uint32_t computeQueueIndex = 0;
+	if (indices.computeFamily.has_value() && indices.computeFamily == indices.transferFamily) {
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+		if (families[indices.computeFamily.value()].queueCount > 1)
+			computeQueueIndex = 1;
+	}
+
+	float queuePriorities[] = { 1.0f, 1.0f };
+	for (uint32_t queueFamily : uniqueQueueFamilies) {
+		VkDeviceQueueCreateInfo queueCreateInfo{};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = queueFamily;
+		queueCreateInfo.queueCount = indices.computeFamily == queueFamily ? computeQueueIndex + 1 : 1;
+		queueCreateInfo.pQueuePriorities = queuePriorities;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
+
+	VkPhysicalDeviceFeatures deviceFeatures{};
+	if (settings.gpuCulling) {
+		VkPhysicalDeviceFeatures supported;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supported);
+		deviceFeatures.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+		deviceFeatures.multiDrawIndirect = supported.multiDrawIndirect;
+	}
+
+	// optional extensions are enabled when the chosen device has them, their feature structs are chained in front
+	std::vector<const char*> extensions = requiredDeviceExtensions();
+	void* featureChain = nullptr;
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	if (settings.timelineSemaphores && supportsTimelineSemaphores(physicalDevice)) {
+		extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineFeatures.timelineSemaphore = VK_TRUE;
+		timelineFeatures.pNext = featureChain;
+		featureChain = &timelineFeatures;
+		timelineSemaphores = true;
+	}
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (settings.bindless && supportsDescriptorIndexing(physicalDevice, indexingFeatures)) {
+		extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		// everything the device supports is left enabled, shaders pick what they rely on
+		indexingFeatures.pNext = featureChain;
+		featureChain = &indexingFeatures;
+		descriptorIndexing = true;
+	}
+	if (settings.gpuCulling && hasDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		drawIndirectCount = true;
+	}
+	// display timing says when each image was shown, present wait only when it has been, so it's the fallback
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	if (settings.measureLatency && !settings.headless) {
+		if (hasDeviceExtension(physicalDevice, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME)) {
+			extensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+			displayTiming = true;
+		}
+		else if (properties2 && hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+			&& hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+			presentIdFeatures.pNext = &presentWaitFeatures;
+			queryFeatures(physicalDevice, &presentIdFeatures);
+			if (presentIdFeatures.presentId && presentWaitFeatures.presentWait) {
+				extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+				extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+				presentWaitFeatures.pNext = featureChain;
+				featureChain = &presentIdFeatures;
+				presentWait = true;
+			}
+		}
+	}
+
+	VkDeviceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = featureChain;
+
+	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	createInfo.pQueueCreateInfos = queueCreateInfos.data();
+
+	createInfo.pEnabledFeatures = &deviceFeatures;
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
+
+	if (debugMode) {
+		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+	}
+	else {
+		createInfo.enabledLayerCount = 0;
+	}
+
+	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create logical device!");
+	}
+	enabledFeatures = deviceFeatures;
+
+	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+	if (indices.presentFamily.has_value())
+		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	else
+		presentQueue = VK_NULL_HANDLE;
+	// without a separate family uploads share the graphics queue
+	if (indices.transferFamily.has_value())
+		vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+	else
+		transferQueue = graphicsQueue;
+	if (indices.computeFamily.has_value())
+		vkGetDeviceQueue(device, indices.computeFamily.value(), computeQueueIndex, &computeQueue);
+	else
+		computeQueue = graphicsQueue;
+	for (VkQueue queue : { graphicsQueue, presentQueue, transferQueue, computeQueue }) {
+		if (queue != VK_NULL_HANDLE)
+			queueLocks[queue];
+	}
+}
+
+std::mutex& Renderer::queueLock(VkQueue queue) {
+	return queueLocks.at(queue);
+}
+
+// devices with every extension the renderer needs, checks that need no surface so they can run while the window opens
+std::vector<VkPhysicalDevice> Renderer::enumerateDevices() {
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	if (deviceCount == 0)
+		throw std::runtime_error("no gpu in this machine has vulkan support");
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+	std::vector<VkPhysicalDevice> extended;
+	for (const auto& device : devices) {
+		if (isDeviceExtended(device))
+			extended.push_back(device);
+	}
+	return extended;
+}
+
+void Renderer::registerDevice(const std::vector<VkPhysicalDevice>& devices) {
+	std::vector<VkPhysicalDevice> candidates;
+	for (const auto& device : devices) {
+		// if current device is valid, add to candidates
+		if(isDeviceSuitable(device)) {
+			candidates.push_back(device);
+		}
+	}
+	if(candidates.size() == 0)
+		throw std::runtime_error("no gpu in this machine has required vulkan features");
+
+	std::multimap<int64_t, VkPhysicalDevice> ratedCandidates;
+	for (const auto& candidate : candidates) {
+		ratedCandidates.insert(std::make_pair(rateDevice(candidate), candidate));
+	}
+	physicalDevice = ratedCandidates.rbegin()->second;
+	std::cout << "vulkan device rating:" << ratedCandidates.rbegin()->first << "\n";
+}
+
+int Renderer::rateDevice(VkPhysicalDevice device) {
+	if(isDeviceSuitable(device) == false)
+		return 0;
+	else {
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(device, &props);
+		int score = 1;
+
+		// max texture size
+		score *= props.limits.maxImageDimension2D + 1;
+
+		switch (props.deviceType) {
+			case VK_PHYSICAL_DEVICE_TYPE_CPU:
+				score *= 1;
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+				score *= 2;
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+				score *= 3;
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+				score *= 4;
+				break;
+			default:
+				score *= 1;
+		}
+
+		return score;
+	}
+}
+
+bool Renderer::isDeviceSuitable(VkPhysicalDevice device) {
+	// extensions were checked by enumerateDevices
+	if (!QueueFamilyIndices::queryDevice(device, window.surface).isPopulated())
+		return false;
+	// headless rendering never creates a swapchain
+	return settings.headless || SwapChainSupport::queryDevice(device, window.surface).isAdequate();
+}
+
+bool Renderer::hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+	for (const auto& extension : availableExtensions) {
+		if (strcmp(extension.extensionName, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+// features beyond vulkan 1.0 can only be asked about through VK_KHR_get_physical_device_properties2
+void Renderer::queryFeatures(VkPhysicalDevice device, void* featureChain) {
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext = featureChain;
+	auto getFeatures = properties2 ? (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR") : nullptr;
+	if (getFeatures != nullptr)
+		getFeatures(device, &features);
+}
+
+void Renderer::queryProperties(VkPhysicalDevice device, void* propertyChain) {
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties.pNext = propertyChain;
+	auto getProperties = properties2 ? (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR") : nullptr;
+	if (getProperties != nullptr)
+		getProperties(device, &properties);
+}
+
+// fills features with what the device supports, true if that covers an update-after-bind table
+bool Renderer::supportsDescriptorIndexing(VkPhysicalDevice device, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features) {
+	if (!hasDeviceExtension(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) || !hasDeviceExtension(device, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+		return false;
+	queryFeatures(device, &features);
+	return features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind
+		&& features.descriptorBindingPartiallyBound && features.runtimeDescriptorArray;
+}
+
+bool Renderer::supportsTimelineSemaphores(VkPhysicalDevice device) {
+	if (!hasDeviceExtension(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		return false;
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	queryFeatures(device, &timelineFeatures);
+	return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+bool Renderer::isDeviceExtended(VkPhysicalDevice device) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	std::set<std::string> requiredExtensions(requiredDeviceExtensions().begin(), requiredDeviceExtensions().end());
+	for (const auto& extension : availableExtensions) {
+		requiredExtensions.erase(extension.extensionName);
+	}
+	return requiredExtensions.empty();
+}
+
+void Renderer::createInstance() {
+	ensureValidationSuccess();
+
+	// fill a struct that contains information about the app
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Renderer";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "None";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+	// the list is long and writing it out is slow on some consoles, so it's only shown when asked for
+	if (settings.verbose)
+		std::cout << "available extensions:\n";
+	for (const auto& extension : extensions) {
+		if (settings.verbose)
+			std::cout << "\t" << extension.extensionName << "\n";
+		if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+			properties2 = true;
+	}
+
+	// fill a struct that informs vulkan of glfw's extensions & our app info
+	VkInstanceCreateInfo creationInfo{};
+	creationInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	creationInfo.pApplicationInfo = &appInfo;
+	// a headless instance has no window system to integrate with
+	uint32_t glfwExtensionCount = 0;
+	const char** glfwExtensions = nullptr;
+	// glfw was initialised on the constructing thread, asking it for extensions is safe from any
+	if (!settings.headless)
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> instanceExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	// needed to ask devices about features added after vulkan 1.0
+	if (properties2)
+		instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	creationInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
+	creationInfo.ppEnabledExtensionNames = instanceExtensions.data();
+	if (debugMode) {
+		creationInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		creationInfo.ppEnabledLayerNames = validationLayers.data();
+	} else {
+		creationInfo.enabledLayerCount = 0;
+	}
+	VkResult result = vkCreateInstance(&creationInfo, nullptr, &instance);
+	if (result == VK_SUCCESS) {
+		std::cout << "created vulkan instance\n";
+	} else {
+		throw std::runtime_error("failed to create vulkan instance. error: " + std::to_string(result));
+	}
+}
+
+void Renderer::ensureValidationSuccess() {
+	if(debugMode) {
+		if(!isValidationAvailable())
+			throw std::runtime_error("vulkan validation layers requested, but aren't available");
+		else
+			std::cout << "vulkan validation is enabled\n";
+	}
+}
+
+bool Renderer::isValidationAvailable() {
+	uint32_t layerCount;
+	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+	std::vector<VkLayerProperties> availableLayers(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+	for (const char* layerName : validationLayers) {
+		for (const auto& layerProperties : availableLayers) {
+			if (strcmp(layerName, layerProperties.layerName) == 0) {
+				goto nextLayer;
+			}
+		}
+		return false;
+		nextLayer:
+		continue;
+	}
+	return true;
+}
+
+void Renderer::destruct() {
+	std::cout << "destructing App\n";
+	scheduler.clean();
+	if (recorder != nullptr) {
+		recorder->clean();
+		delete recorder;
+	}
+	for (auto& frame : frames) {
+		frame.clean();
+	}
+	if (compute != nullptr) {
+		compute->clean();
+		delete compute;
+	}
+	delete latency;
+	target.clean(*this);
+	for (auto& retired : retiredTargets) {
+		retired.second.clean(*this);
+	}
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipeline(device, prepassPipeline, nullptr);
+	// variants are built into the pipeline cache, so they have to finish before it's saved
+	compiler->clean();
+	delete compiler;
+	if (culler != nullptr) {
+		culler->clean();
+		delete culler;
+	}
+	if (transforms != nullptr) {
+		transforms->clean(*this);
+		delete transforms;
+	}
+	delete scene;
+	// the streamer's workers upload through the staging ring and its images hold bindless slots
+	textures->clean();
+	delete textures;
+	if (mesh != nullptr) {
+		mesh->clean(*this);
+		delete mesh;
+	}
+	uniforms.clean(*this);
+	uploads->clean();
+	delete uploads;
+	allocator->clean();
+	delete allocator;
+	if (bindless != nullptr) {
+		bindless->clean();
+		delete bindless;
+	}
+	profiler.clean();
+	pipelineCache.save();
+	pipelineCache.clean();
+	for (auto& shaderModule : shaderModules) {
+		delete shaderModule;
+	}
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyPipelineLayout(device, layoutBundle.layout, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+	vkDestroyDevice(device, nullptr);
+	if (!settings.headless)
 		vkDestroySurfaceKHR(instance, window.surface, nullptr);
-		vkDestroyInstance(instance, nullptr);
+	vkDestroyInstance(instance, nullptr);
+	if (!settings.headless) {
 		glfwDestroyWindow(window.window);
 		glfwTerminate();
 	}
-	std::vector<char> readFile(const std::string& filename) {
-		// read file as binary, place cursor at end
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-		if (!file.is_open())
-			throw std::runtime_error("failed to open file " + filename);
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
-		file.seekg(0); // put cursor at start of file
-		file.read(buffer.data(), fileSize); // read entire file, storing contents in buffer
-		file.close();
-		return buffer;
-	}
-};
+	trace.close();
+}
+
+ShaderModule* Renderer::loadShader(const std::string& path) {
+	// embedded code is handed to the driver in place, nothing is opened or copied
+	if (const ShaderBinary* binary = ShaderRegistry::find(path))
+		return new ShaderModule(binary->code, binary->size, device);
+	return new ShaderModule(readFile(path), device);
+}
+
+std::vector<char> Renderer::readFile(const std::string& filename) {
+	// read file as binary, place cursor at end
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open file " + filename);
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+	file.seekg(0); // put cursor at start of file
+	file.read(buffer.data(), fileSize); // read entire file, storing contents in buffer
+	file.close();
+	return buffer;
+}
@@ -4,35 +4,182 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <map>
+#include <mutex>
 #include <vector>
+#include <utility>
+#include <string>
 
+#include "RenderSettings.h"
 #include "Window.h"
 #include "RenderTarget.h"
 #include "QueueFamilyIndices.h"
 #include "RenderGate.h"
 #include "LayoutBundle.h"
+#include "ShaderModule.h"
+#include "GpuProfiler.h"
+#include "TraceWriter.h"
+#include "StartupTrace.h"
+#include "PipelineCache.h"
+#include "FrameScheduler.h"
+#include "MemoryAllocator.h"
+#include "UploadService.h"
+#include "CommandRecorder.h"
+#include "FrameContext.h"
+#include "GpuCuller.h"
+#include "ComputeQueue.h"
+#include "PipelineCompiler.h"
+#include "BindlessTable.h"
+#include "UniformRing.h"
+#include "TextureStreamer.h"
+#include "Mesh.h"
+#include "LatencyTracker.h"
+#include "SceneStore.h"
+#include "TransformHierarchy.h"
 
 class Renderer {
 public:
+	RenderSettings settings;
 	Window window;
 	RenderTarget target;
+	// replaced targets paired with the frame they were retired on
+	std::vector<std::pair<size_t, RenderTarget>> retiredTargets;
 	VkInstance instance;
-	VkPhysicalDevice physicalDevice;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
+	// the async compute queue, or the graphics queue when the device has no separate compute family
+	VkQueue computeQueue;
+	// the queues above can be one and the same, and uploads submit from worker threads,
+	// so every submit and present holds its queue's lock
+	std::mutex& queueLock(VkQueue queue);
 	QueueFamilyIndices indices;
 	VkRenderPass renderPass;
+	// format of the render target's depth buffer, chosen with the render pass
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	// of the scene's attachments, the target image itself always has one sample
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	// layouts the render pass leaves the target image and the depth buffer in
+	VkImageLayout targetLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImageLayout depthLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// subpass the scene is shaded in, 1 after the depth prepass when there is one
+	uint32_t sceneSubpass = 0;
 	LayoutBundle layoutBundle;
-	VkPipelineShaderStageCreateInfo* stages;
+	// the default pipeline, always built before the first frame
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	// its depth only counterpart for the prepass, null without one
+	VkPipeline prepassPipeline = VK_NULL_HANDLE;
+	PipelineCompiler* compiler = nullptr;
+	// the scene's own pipeline while it is built in the background, invalid when the default one is the scene's
+	uint32_t scenePipelineHandle = PipelineCompiler::INVALID_HANDLE;
+	uint32_t scenePrepassHandle = PipelineCompiler::INVALID_HANDLE;
+	PipelineCache pipelineCache;
+	std::vector<ShaderModule*> shaderModules;
+	std::vector<VkPipelineShaderStageCreateInfo> stages;
 	VkCommandPool commandPool;
-	std::vector<VkCommandBuffer> commandBuffers;
-	std::vector<RenderGate*> renderGates;
+	FrameScheduler scheduler;
+	MemoryAllocator* allocator = nullptr;
+	UploadService* uploads = nullptr;
+	// per frame uniform blocks, a region per frame in flight
+	UniformRing uniforms;
+	// this frame's block for every draw when settings.drawData is Uniform
+	LinearAllocation drawUniforms;
+	// one per frame in flight when the scene is recorded every frame
+	std::vector<FrameContext> frames;
+	// null when the scene is recorded on the calling thread
+	CommandRecorder* recorder = nullptr;
+	// the objects drawn each frame, in the order they are drawn
+	SceneStore* scene = nullptr;
+	// null unless settings.transformFanout is set, node i is the scene's object i
+	TransformHierarchy* transforms = nullptr;
+	// null when the cpu records a draw per object
+	GpuCuller* culler = nullptr;
+	// null unless bindless descriptors were asked for and the device has descriptor indexing
+	BindlessTable* bindless = nullptr;
+	// null unless settings.meshPath names a mesh, pipelines then take its vertex layout
+	Mesh* mesh = nullptr;
+	// ktx2 textures streamed from mapped files, registered in the bindless table when there is one
+	TextureStreamer* textures = nullptr;
+	// null unless settings.measureLatency is on and there is a window
+	LatencyTracker* latency = nullptr;
+	// null unless async compute was asked for and the device has a separate compute family
+	ComputeQueue* compute = nullptr;
+	// instance has VK_KHR_get_physical_device_properties2
+	bool properties2 = false;
+	// device was created with VK_KHR_timeline_semaphore
+	bool timelineSemaphores = false;
+	// device was created with VK_KHR_draw_indirect_count
+	bool drawIndirectCount = false;
+	// device was created with VK_EXT_descriptor_indexing
+	bool descriptorIndexing = false;
+	// device was created with VK_GOOGLE_display_timing, or with VK_KHR_present_id and VK_KHR_present_wait
+	bool displayTiming = false;
+	bool presentWait = false;
+	VkPhysicalDeviceFeatures enabledFeatures{};
 	size_t currentFrame = 0;
-	Renderer();
+	GpuProfiler profiler;
+	TraceWriter trace;
+	// covers the constructor and the first frame
+	StartupTrace startup;
+	Renderer(RenderSettings settings = RenderSettings());
 	VkGraphicsPipelineCreateInfo genPipelineInfo();
+	VkFormat targetFormat();
+	// the pipeline to draw the scene with this frame, VK_NULL_HANDLE when the scene should be skipped
+	// prepass receives the matching depth only pipeline, null when there is no depth prepass
+	VkPipeline scenePipeline(VkPipeline* prepass = nullptr);
 	void run();
+	void drawFrame();
+	// the frame limit is reached or the window was asked to close
+	bool shouldClose();
+	void setFramesInFlight(uint32_t framesInFlight);
+	// rebuilds the swapchain with the policy's present mode and image count, frames in flight finish on the old one
+	void setPresentPolicy(PresentPolicy policy);
+	bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
+	void queryFeatures(VkPhysicalDevice device, void* featureChain);
+	void queryProperties(VkPhysicalDevice device, void* propertyChain);
+	std::vector<char> readFile(const std::string& filename);
+	// uses the copy embedded by the build when there is one, otherwise reads the file
+	ShaderModule* loadShader(const std::string& path);
+	// triangles per row and column of the grid instances are laid out on
+	uint32_t gridSide = 1;
 	~Renderer();
+
+private:
+	// one per distinct queue, filled in once the device is created and only read after that
+	std::map<VkQueue, std::mutex> queueLocks;
+	VkSpecializationMapEntry gridSideEntry{};
+	VkSpecializationInfo specialization{};
+
+	const std::vector<const char*>& requiredDeviceExtensions();
+	void rebuildTarget();
+	void releaseRetiredTargets();
+	void finishStartup(uint64_t frameStart);
+	void resizeFrames();
+	VkDeviceSize uniformRingSize();
+	// what the default pipeline draws with while the scene's own shader compiles
+	const std::string& defaultVertexShader();
+	VkFormat findDepthFormat();
+	VkSampleCountFlagBits chooseSampleCount();
+	void buildScene();
+	void animateTransforms();
+	void initRenderPass();
+	void initPipeline();
+	void initShaderStages();
+	void createCommandPool();
+	void createLogicalDevice();
+	std::vector<VkPhysicalDevice> enumerateDevices();
+	void registerDevice(const std::vector<VkPhysicalDevice>& devices);
+	int rateDevice(VkPhysicalDevice device);
+	bool isDeviceSuitable(VkPhysicalDevice device);
+	bool isDeviceExtended(VkPhysicalDevice device);
+	bool supportsTimelineSemaphores(VkPhysicalDevice device);
+	bool supportsDescriptorIndexing(VkPhysicalDevice device, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features);
+	void createInstance();
+	void ensureValidationSuccess();
+	bool isValidationAvailable();
+	void destruct();
 };
 
 #endif
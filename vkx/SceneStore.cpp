@@ -0,0 +1,211 @@
+#include "SceneStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// vector kernels on x86-64, where sse is always there and avx2 is checked for at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define VKX_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// msvc compiles intrinsics for any instruction set without flags
+#define VKX_TARGET_AVX2
+#else
+#define VKX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// every kernel sums the same terms in the same order, so they agree on spheres that just touch a plane
+static uint32_t cullScalar(const SceneStore& scene, uint32_t begin, uint32_t end, uint32_t* out) {
+	uint32_t count = 0;
+	for (uint32_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (uint32_t p = 0; p < 6; p++) {
+			const float* plane = scene.frustum[p];
+			float distance = (scene.centerX[i] * plane[0] + scene.centerY[i] * plane[1]) + (scene.centerZ[i] * plane[2] + plane[3]);
+			inside = inside && distance + scene.radius[i] >= 0.0f;
+		}
+		out[count] = i;
+		count += inside ? 1 : 0;
+	}
+	return count;
+}
+
+#ifdef VKX_X86
+// survivors are written without branching: every lane stores its index, only those inside move the end along
+static uint32_t cullSse(const SceneStore& scene, uint32_t begin, uint32_t end, uint32_t* out) {
+	__m128 planes[6][4];
+	for (uint32_t p = 0; p < 6; p++) {
+		for (uint32_t c = 0; c < 4; c++)
+			planes[p][c] = _mm_set1_ps(scene.frustum[p][c]);
+	}
+	__m128 zero = _mm_setzero_ps();
+	uint32_t count = 0;
+	uint32_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(&scene.centerX[i]);
+		__m128 y = _mm_loadu_ps(&scene.centerY[i]);
+		__m128 z = _mm_loadu_ps(&scene.centerZ[i]);
+		__m128 r = _mm_loadu_ps(&scene.radius[i]);
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (uint32_t p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planes[p][0]), _mm_mul_ps(y, planes[p][1])),
+				_mm_add_ps(_mm_mul_ps(z, planes[p][2]), planes[p][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+		}
+		uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			out[count] = i + lane;
+			count += (mask >> lane) & 1;
+		}
+	}
+	return count + cullScalar(scene, i, end, out + count);
+}
+
+VKX_TARGET_AVX2 static uint32_t cullAvx2(const SceneStore& scene, uint32_t begin, uint32_t end, uint32_t* out) {
+	__m256 planes[6][4];
+	for (uint32_t p = 0; p < 6; p++) {
+		for (uint32_t c = 0; c < 4; c++)
+			planes[p][c] = _mm256_set1_ps(scene.frustum[p][c]);
+	}
+	__m256 zero = _mm256_setzero_ps();
+	uint32_t count = 0;
+	uint32_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(&scene.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&scene.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&scene.centerZ[i]);
+		__m256 r = _mm256_loadu_ps(&scene.radius[i]);
+		__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+		for (uint32_t p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planes[p][0]), _mm256_mul_ps(y, planes[p][1])),
+				_mm256_add_ps(_mm256_mul_ps(z, planes[p][2]), planes[p][3]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+		}
+		uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 8; lane++) {
+			out[count] = i + lane;
+			count += (mask >> lane) & 1;
+		}
+	}
+	return count + cullSse(scene, i, end, out + count);
+}
+#endif
+
+static CullKernel detectKernel() {
+#ifdef VKX_X86
+	bool avx2 = false;
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7) {
+		__cpuid(info, 1);
+		// the os has to save the ymm registers on context switches as well
+		bool savesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		avx2 = savesYmm && (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2");
+#endif
+	return avx2 ? CullKernel::Avx2 : CullKernel::Sse;
+#else
+	return CullKernel::Scalar;
+#endif
+}
+
+SceneStore::SceneStore(uint32_t threadCount) : workers(std::max(threadCount, 1u)) {
+	kernel = detectKernel();
+	visible.resize(8);
+}
+
+uint32_t SceneStore::objectCount() {
+	return (uint32_t)radius.size();
+}
+
+void SceneStore::reserve(uint32_t count) {
+	transforms.reserve(count);
+	centerX.reserve(count);
+	centerY.reserve(count);
+	centerZ.reserve(count);
+	radius.reserve(count);
+	firstInstance.reserve(count);
+	instanceCount.reserve(count);
+	meshIndex.reserve(count);
+	materialIndex.reserve(count);
+	visible.reserve(count + 8);
+}
+
+uint32_t SceneStore::add(const DrawTransform& transform, const float sphere[4], uint32_t first, uint32_t count, uint32_t mesh, uint32_t material) {
+	transforms.push_back(transform);
+	centerX.push_back(sphere[0]);
+	centerY.push_back(sphere[1]);
+	centerZ.push_back(sphere[2]);
+	radius.push_back(sphere[3]);
+	firstInstance.push_back(first);
+	instanceCount.push_back(count);
+	meshIndex.push_back(mesh);
+	materialIndex.push_back(material);
+	uint32_t index = objectCount() - 1;
+	visible.resize(objectCount() + 8);
+	visible[visibleCount++] = index;
+	return index;
+}
+
+void SceneStore::showAll() {
+	visibleCount = objectCount();
+	for (uint32_t i = 0; i < visibleCount; i++)
+		visible[i] = i;
+}
+
+// each task culls its share into its own list, then the lists are packed into visible in parallel
+uint32_t SceneStore::cull() {
+	auto start = std::chrono::steady_clock::now();
+	uint32_t count = objectCount();
+	uint32_t tasks = std::clamp(count / MIN_OBJECTS_PER_TASK, 1u, workers.workerCount() * TASKS_PER_WORKER);
+	if (tasks == 1)
+		visibleCount = cullRange(0, count, visible.data());
+	else {
+		taskVisible.resize(tasks);
+		taskCounts.resize(tasks);
+		workers.run(tasks, [&](uint32_t task, uint32_t worker) {
+			// shares start on a multiple of 8 so only the last one has a partial vector
+			uint32_t begin = (uint32_t)((uint64_t)count * task / tasks) & ~7u;
+			uint32_t end = task + 1 == tasks ? count : (uint32_t)((uint64_t)count * (task + 1) / tasks) & ~7u;
+			std::vector<uint32_t>& out = taskVisible[task];
+			if (out.size() < end - begin + 8)
+				out.resize(end - begin + 8);
+			taskCounts[task] = cullRange(begin, end, out.data());
+		});
+		visibleCount = 0;
+		for (uint32_t task = 0; task < tasks; task++) {
+			uint32_t taskCount = taskCounts[task];
+			taskCounts[task] = visibleCount;
+			visibleCount += taskCount;
+		}
+		workers.run(tasks, [&](uint32_t task, uint32_t worker) {
+			uint32_t end = task + 1 == tasks ? visibleCount : taskCounts[task + 1];
+			memcpy(visible.data() + taskCounts[task], taskVisible[task].data(), (end - taskCounts[task]) * sizeof(uint32_t));
+		});
+	}
+	lastCullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	totalCullMs += lastCullMs;
+	culls++;
+	return visibleCount;
+}
+
+uint32_t SceneStore::cullRange(uint32_t begin, uint32_t end, uint32_t* out) {
+	switch (kernel) {
+#ifdef VKX_X86
+	case CullKernel::Avx2:
+		return cullAvx2(*this, begin, end, out);
+	case CullKernel::Sse:
+		return cullSse(*this, begin, end, out);
+#endif
+	default:
+		return cullScalar(*this, begin, end, out);
+	}
+}
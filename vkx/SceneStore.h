@@ -0,0 +1,94 @@
+#ifndef SceneStore_h
+#define SceneStore_h
+
+#include <cstdint>
+#include <vector>
+
+#include "WorkerPool.h"
+
+// per draw data recorded with the scene's draws when RenderSettings::drawData asks for it
+class DrawTransform {
+public:
+	float matrix[16];
+};
+
+// the widest frustum test the cpu can run, picked once when the store is created
+enum class CullKernel {
+	Scalar,
+	// 4 objects at a time, every x86-64 cpu has it
+	Sse,
+	// 8 objects at a time
+	Avx2
+};
+
+inline const char* cullKernelName(CullKernel kernel) {
+	switch (kernel) {
+	case CullKernel::Sse:
+		return "sse";
+	case CullKernel::Avx2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+// the scene's objects as one array per field, so culling streams through just the bounds it tests
+// an object is drawn as a run of instances, with its own transform, mesh and material
+// visible lists the objects to draw in order, every object until the first cull
+class SceneStore {
+public:
+	// fewer objects than this per task cost more to hand out than they save
+	static const uint32_t MIN_OBJECTS_PER_TASK = 16384;
+	// tasks per worker, so threads that finish early can take over another's work
+	static const uint32_t TASKS_PER_WORKER = 4;
+	// planes as (normal, distance), an object is kept while its sphere is in front of or touching all six
+	// defaults to the clip space volume the scene's triangles are placed in
+	float frustum[6][4] = {
+		{ 1, 0, 0, 1 }, { -1, 0, 0, 1 },
+		{ 0, 1, 0, 1 }, { 0, -1, 0, 1 },
+		{ 0, 0, 1, 0 }, { 0, 0, -1, 1 }
+	};
+	CullKernel kernel = CullKernel::Scalar;
+	std::vector<DrawTransform> transforms;
+	// bounding spheres
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+	std::vector<uint32_t> firstInstance;
+	std::vector<uint32_t> instanceCount;
+	// every object draws the renderer's one mesh with no material for now
+	std::vector<uint32_t> meshIndex;
+	std::vector<uint32_t> materialIndex;
+	// the first visibleCount entries are object indices in ascending order, the rest is room for the kernels' stores
+	std::vector<uint32_t> visible;
+	uint32_t visibleCount = 0;
+	// cpu time of the last cull and of every cull so far
+	double lastCullMs = 0;
+	double totalCullMs = 0;
+	uint64_t culls = 0;
+
+	// culls on this many threads, the calling thread included
+	SceneStore(uint32_t threadCount);
+	SceneStore(const SceneStore&) = delete;
+	SceneStore& operator=(const SceneStore&) = delete;
+	uint32_t objectCount();
+	void reserve(uint32_t count);
+	// sphere is the centre and radius, returns the object's index
+	uint32_t add(const DrawTransform& transform, const float sphere[4], uint32_t first, uint32_t count, uint32_t mesh, uint32_t material);
+	// makes every object visible, as drawing without culling does
+	void showAll();
+	// tests every object against the frustum and rebuilds visible, returns visibleCount
+	uint32_t cull();
+
+private:
+	WorkerPool workers;
+	// each task's survivors before they are packed into visible
+	std::vector<std::vector<uint32_t>> taskVisible;
+	std::vector<uint32_t> taskCounts;
+
+	// writes the survivors among objects begin to end to out, which needs room for 8 more than there are objects
+	uint32_t cullRange(uint32_t begin, uint32_t end, uint32_t* out);
+};
+
+#endif
@@ -2,35 +2,32 @@
 
 #include <stdexcept>
 
-class ShaderModule {
-	public:
-		VkShaderModule shader;
-		VkDevice device;
+ShaderModule::~ShaderModule() {
+	vkDestroyShaderModule(device, shader, nullptr);
+}
 
-		~ShaderModule() {
-			vkDestroyShaderModule(device, shader, nullptr);
-		}
+VkPipelineShaderStageCreateInfo ShaderModule::shaderCreateInfo(bool isFrag) {
+	return shaderCreateInfo(isFrag ? VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_VERTEX_BIT);
+}
 
-		VkPipelineShaderStageCreateInfo shaderCreateInfo(bool isFrag) {
-			VkPipelineShaderStageCreateInfo shaderStageInfo{};
-			shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-			if (isFrag)
-				shaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-			else
-				shaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-			shaderStageInfo.module = shader;
-			shaderStageInfo.pName = "main"; // set process name to main
-			return shaderStageInfo;
-		}
+VkPipelineShaderStageCreateInfo ShaderModule::shaderCreateInfo(VkShaderStageFlagBits stage) {
+	VkPipelineShaderStageCreateInfo shaderStageInfo{};
+	shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageInfo.stage = stage;
+	shaderStageInfo.module = shader;
+	shaderStageInfo.pName = "main"; // set process name to main
+	return shaderStageInfo;
+}
 
-		ShaderModule(const std::vector<char>& code, const VkDevice& device) {
-			this->device = device;
-			VkShaderModuleCreateInfo createInfo{};
-			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			createInfo.codeSize = code.size();
-			createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-			if (vkCreateShaderModule(device, &createInfo, nullptr, &shader) != VK_SUCCESS)
-				throw std::runtime_error("Failed to instantiate ShaderModule");
-		}
+ShaderModule::ShaderModule(const std::vector<char>& code, const VkDevice& device)
+	: ShaderModule(reinterpret_cast<const uint32_t*>(code.data()), code.size(), device) {}
 
-};
+ShaderModule::ShaderModule(const uint32_t* code, size_t size, const VkDevice& device) {
+	this->device = device;
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = size;
+	createInfo.pCode = code;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shader) != VK_SUCCESS)
+		throw std::runtime_error("Failed to instantiate ShaderModule");
+}
@@ -13,7 +13,10 @@ public:
 
 	~ShaderModule();
 	VkPipelineShaderStageCreateInfo shaderCreateInfo(bool isFrag);
+	VkPipelineShaderStageCreateInfo shaderCreateInfo(VkShaderStageFlagBits stage);
 	ShaderModule(const std::vector<char>& code, const VkDevice& device);
+	// size is in bytes, the code is only read while the module is created
+	ShaderModule(const uint32_t* code, size_t size, const VkDevice& device);
 
 };
 
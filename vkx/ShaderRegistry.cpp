@@ -0,0 +1,20 @@
+#include "ShaderRegistry.h"
+
+#include <cstring>
+
+#ifdef VKX_EMBED_SHADERS
+// generated from the compiled shaders by cmake/EmbedShaders.cmake
+#include "EmbeddedShaders.inc"
+#else
+static const ShaderBinary embeddedShaders[] = {
+	{ nullptr, nullptr, 0 }
+};
+#endif
+
+const ShaderBinary* ShaderRegistry::find(const std::string& name) {
+	for (const ShaderBinary* shader = embeddedShaders; shader->name != nullptr; shader++) {
+		if (name == shader->name)
+			return shader;
+	}
+	return nullptr;
+}
@@ -0,0 +1,24 @@
+#ifndef ShaderRegistry_h
+#define ShaderRegistry_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// a SPIR-V binary compiled into the executable
+class ShaderBinary {
+public:
+	const char* name;
+	const uint32_t* code;
+	// in bytes
+	size_t size;
+};
+
+// shaders embedded by the build, looked up by the path they would otherwise be loaded from
+class ShaderRegistry {
+public:
+	// null when the build embedded no shader under that name
+	static const ShaderBinary* find(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "StartupTrace.h"
+
+#include <algorithm>
+#include <iomanip>
+
+StartupTrace::StartupTrace(TraceWriter& trace) : trace(trace) {
+	start = TraceWriter::now();
+	firstTrack = TraceWriter::threadTrack();
+}
+
+void StartupTrace::record(const char* name, uint64_t startNs, uint64_t durationNs) {
+	uint32_t track = TraceWriter::threadTrack();
+	if (trace.isOpen())
+		trace.complete(name, "startup", track, startNs, durationNs);
+	std::lock_guard<std::mutex> guard(lock);
+	Phase phase;
+	phase.name = name;
+	phase.startNs = startNs;
+	phase.durationNs = durationNs;
+	phase.track = track;
+	phases.push_back(phase);
+}
+
+void StartupTrace::finish() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (end == 0)
+		end = TraceWriter::now();
+}
+
+double StartupTrace::totalMs() {
+	std::lock_guard<std::mutex> guard(lock);
+	return end != 0 ? (end - start) / 1e6 : 0.0;
+}
+
+void StartupTrace::report(std::ostream& out) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<Phase> ordered(phases);
+	std::stable_sort(ordered.begin(), ordered.end(), [](const Phase& a, const Phase& b) { return a.startNs < b.startNs; });
+	uint64_t total = (end != 0 ? end : TraceWriter::now()) - start;
+	out << std::fixed << std::setprecision(1);
+	out << "startup took " << total / 1e6 << " ms to the first frame\n";
+	for (auto& phase : ordered) {
+		out << "\t" << std::setw(8) << phase.durationNs / 1e6 << " ms  " << phase.name;
+		// steps off the constructing thread overlapped with the ones around them
+		if (phase.track != firstTrack)
+			out << " (in parallel)";
+		out << "\n";
+	}
+	out << std::defaultfloat;
+}
+
+StartupPhase::StartupPhase(StartupTrace& startup, const char* name) : startup(startup), name(name) {
+	start = TraceWriter::now();
+}
+
+StartupPhase::~StartupPhase() {
+	startup.record(name, start, TraceWriter::now() - start);
+}
@@ -0,0 +1,55 @@
+#ifndef StartupTrace_h
+#define StartupTrace_h
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TraceWriter.h"
+
+// how long each step of bringing the renderer up took, up to its first presented frame
+// steps may run on several threads at once, each is also written to the trace as a zone
+class StartupTrace {
+public:
+	StartupTrace(TraceWriter& trace);
+	// safe to call from any thread, times are on the TraceWriter::now() clock
+	void record(const char* name, uint64_t startNs, uint64_t durationNs);
+	// closes the trace at the first frame, later calls do nothing
+	void finish();
+	// from construction to the first frame, 0 until then
+	double totalMs();
+	// every step in the order they started, with the threads other than the first marked
+	void report(std::ostream& out);
+
+private:
+	class Phase {
+	public:
+		std::string name;
+		uint64_t startNs = 0;
+		uint64_t durationNs = 0;
+		uint32_t track = 0;
+	};
+
+	TraceWriter& trace;
+	std::mutex lock;
+	std::vector<Phase> phases;
+	uint64_t start = 0;
+	uint64_t end = 0;
+	uint32_t firstTrack = 0;
+};
+
+// times the enclosing scope as one startup step
+class StartupPhase {
+public:
+	StartupPhase(StartupTrace& startup, const char* name);
+	~StartupPhase();
+
+private:
+	StartupTrace& startup;
+	const char* name;
+	uint64_t start;
+};
+
+#endif
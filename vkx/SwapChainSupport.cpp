@@ -1,102 +1,137 @@
 #include "SwapChainSupport.h"
 
-class SwapChainSupport {
-	public:
-		VkSurfaceCapabilitiesKHR capabilities;
-		std::vector<VkSurfaceFormatKHR> formats;
-		std::vector<VkPresentModeKHR> presentModes;
-		bool isAdequate() {
-			return !formats.empty() && !presentModes.empty();
-		}
-		VkSwapchainCreateInfoKHR buildInfoStruct(const Renderer& renderer, const Window& window) {
-			VkSwapchainCreateInfoKHR createInfo{};
-			createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-			createInfo.surface = renderer.window.surface;
-			createInfo.minImageCount = preferredImageCount();
-			createInfo.imageFormat = preferredSurfaceFormat().format;
-			createInfo.imageColorSpace = preferredSurfaceFormat().colorSpace;
-			createInfo.imageExtent = preferredFrameBufferSize(window);
-			createInfo.imageArrayLayers = 1;
-			createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // simple usage
-			createInfo.preTransform = capabilities.currentTransform;
-			createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-			createInfo.presentMode = preferredPresentMode();
-			createInfo.clipped = VK_TRUE;
-			createInfo.oldSwapchain = VK_NULL_HANDLE;
-
-			uint32_t queueFamilyIndicesArray[] = {
-				renderer.indices.graphicsFamily.value(),
-				renderer.indices.presentFamily.value()
-			};
-			if (renderer.indices.graphicsFamily != renderer.indices.presentFamily) {
-				createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-				createInfo.queueFamilyIndexCount = 2;
-				createInfo.pQueueFamilyIndices = queueFamilyIndicesArray;
-			}
-			else
-				createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			return createInfo;
-		}
-		VkSurfaceFormatKHR preferredSurfaceFormat() {
-			// prefer RGBA 8 bit encoding in SRGB colorspace
-			for (const auto& format : formats) {
-				if (format.format == VK_FORMAT_R8G8B8A8_SRGB && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
-					return format;
-			}
-			return formats[0];
-		}
-		VkPresentModeKHR preferredPresentMode() {
-			// prefer "triple-buffer" vsync
-			for (const auto& presentMode : presentModes) {
-				if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-					return presentMode;
-			}
-			// vsync
-			return VK_PRESENT_MODE_FIFO_KHR;
-		}
-		VkExtent2D preferredFrameBufferSize(const Window& window) {
-			if (capabilities.currentExtent.width != UINT32_MAX) {
-				return capabilities.currentExtent;
-			} else {
-				int width, height = 0;
-				glfwGetFramebufferSize(window.window, &width, &height);
-				VkExtent2D actualExtent = {
-					static_cast<uint32_t>(width),
-					static_cast<uint32_t>(height)
-				};
-				actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
-				actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
-				return actualExtent;
-			}
-		}
-		uint32_t preferredImageCount() {
-			uint32_t imageCount = capabilities.minImageCount + 1;
-			if(capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
-				imageCount = capabilities.maxImageCount;
-			return imageCount;
-		}
-		static SwapChainSupport queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface) {
-			SwapChainSupport details;
-
-			vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-			uint32_t formatCount;
-			vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-			if (formatCount != 0) {
-				details.formats.resize(formatCount);
-				vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-			}
-
-			uint32_t presentModeCount;
-			vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-			if (presentModeCount != 0) {
-				details.presentModes.resize(presentModeCount);
-				vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-			}
-
-			return details;
-		}
-};
+#include <algorithm>
+
+#include "Renderer.h"
+
+bool SwapChainSupport::isAdequate() {
+	return !formats.empty() && !presentModes.empty();
+}
+
+VkSwapchainCreateInfoKHR SwapChainSupport::buildInfoStruct(const Renderer& renderer, const Window& window, VkSwapchainKHR oldSwapchain) {
+	VkSwapchainCreateInfoKHR createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = renderer.window.surface;
+	createInfo.minImageCount = preferredImageCount(renderer.settings.presentPolicy);
+	createInfo.imageFormat = preferredSurfaceFormat().format;
+	createInfo.imageColorSpace = preferredSurfaceFormat().colorSpace;
+	createInfo.imageExtent = preferredFrameBufferSize(window);
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // simple usage
+	createInfo.preTransform = capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = preferredPresentMode(renderer.settings.presentPolicy);
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = oldSwapchain;
+
+	// kept in this object so the returned struct can point at it
+	sharedFamilies[0] = renderer.indices.graphicsFamily.value();
+	sharedFamilies[1] = renderer.indices.presentFamily.value();
+	if (renderer.indices.graphicsFamily != renderer.indices.presentFamily) {
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = sharedFamilies;
+	}
+	else
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	return createInfo;
+}
+
+VkSurfaceFormatKHR SwapChainSupport::preferredSurfaceFormat() {
+	// prefer RGBA 8 bit encoding in SRGB colorspace
+	for (const auto& format : formats) {
+		if (format.format == VK_FORMAT_R8G8B8A8_SRGB && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
+			return format;
+	}
+	return formats[0];
+}
+
+VkPresentModeKHR SwapChainSupport::preferredPresentMode(PresentPolicy policy) {
+	std::vector<VkPresentModeKHR> wanted;
+	switch (policy) {
+	case PresentPolicy::LowLatency:
+		// shown at once, tearing included, or at the next vertical blank with nothing queued behind it
+		wanted = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case PresentPolicy::Throughput:
+		// "triple-buffer" vsync, rendering never waits for the display
+		wanted = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+		break;
+	case PresentPolicy::PowerSaving:
+		// vsync that lets a late frame through rather than waiting a whole refresh
+		wanted = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+		break;
+	}
+	for (auto presentMode : wanted) {
+		if (hasPresentMode(presentMode))
+			return presentMode;
+	}
+	// vsync, the only mode every surface has
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+bool SwapChainSupport::hasPresentMode(VkPresentModeKHR presentMode) {
+	return std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end();
+}
+
+VkExtent2D SwapChainSupport::preferredFrameBufferSize(const Window& window) {
+	if (capabilities.currentExtent.width != UINT32_MAX) {
+		return capabilities.currentExtent;
+	} else {
+		int width, height = 0;
+		glfwGetFramebufferSize(window.window, &width, &height);
+		VkExtent2D actualExtent = {
+			static_cast<uint32_t>(width),
+			static_cast<uint32_t>(height)
+		};
+		actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
+		actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
+		return actualExtent;
+	}
+}
+
+uint32_t SwapChainSupport::preferredImageCount(PresentPolicy policy) {
+	// every image beyond the minimum is another frame that can be queued between input and display
+	uint32_t imageCount = capabilities.minImageCount + (policy == PresentPolicy::LowLatency ? 0 : 1);
+	if(capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
+		imageCount = capabilities.maxImageCount;
+	return imageCount;
+}
+
+SwapChainSupport SwapChainSupport::queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface) {
+	SwapChainSupport details;
+
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+	uint32_t formatCount;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+
+	if (formatCount != 0) {
+		details.formats.resize(formatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+	}
+
+	uint32_t presentModeCount;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+	if (presentModeCount != 0) {
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+	}
+
+	return details;
+}
+
+const char* SwapChainSupport::presentModeName(VkPresentModeKHR presentMode) {
+	switch (presentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "fifo-relaxed";
+	default:
+		return "fifo";
+	}
+}
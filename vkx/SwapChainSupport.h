@@ -6,21 +6,26 @@
 
 #include <vector>
 
-#include "Window.h"
-#include "Renderer.h"
+#include "RenderSettings.h"
+
+class Renderer;
+class Window;
 
 class SwapChainSupport {
 public:
 	VkSurfaceCapabilitiesKHR capabilities;
 	std::vector<VkSurfaceFormatKHR> formats;
 	std::vector<VkPresentModeKHR> presentModes;
+	uint32_t sharedFamilies[2];
 	bool isAdequate();
-	VkSwapchainCreateInfoKHR buildInfoStruct(const Renderer& renderer, const Window& window);
+	VkSwapchainCreateInfoKHR buildInfoStruct(const Renderer& renderer, const Window& window, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 	VkSurfaceFormatKHR preferredSurfaceFormat();
-	VkPresentModeKHR preferredPresentMode();
+	VkPresentModeKHR preferredPresentMode(PresentPolicy policy);
 	VkExtent2D preferredFrameBufferSize(const Window& window);
-	uint32_t preferredImageCount();
+	uint32_t preferredImageCount(PresentPolicy policy);
+	bool hasPresentMode(VkPresentModeKHR presentMode);
 	static SwapChainSupport queryDevice(VkPhysicalDevice& device, VkSurfaceKHR& surface);
+	static const char* presentModeName(VkPresentModeKHR presentMode);
 };
 
 #endif
@@ -0,0 +1,315 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+bool StreamedTexture::isReady() {
+	return image != VK_NULL_HANDLE;
+}
+
+VkDeviceSize StreamedTexture::bytesFrom(uint32_t level) {
+	VkDeviceSize bytes = 0;
+	for (uint32_t i = level; i < file->levelCount; i++)
+		bytes += file->levels[i].uncompressedByteLength;
+	return bytes;
+}
+
+TextureStreamer::TextureStreamer(Renderer& renderer, VkDeviceSize budget, uint32_t threadCount) : renderer(renderer) {
+	this->budget = budget;
+	// half the ring, so a level never has to wait for the whole ring to drain
+	maxUploadSize = renderer.uploads->stagingSize / 2;
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	// images are rebuilt with more or fewer levels, the sampler takes whatever the view has
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(renderer.device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+		throw std::runtime_error("failed to create texture sampler");
+
+	for (uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+		threads.emplace_back(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+	clean();
+}
+
+StreamedTexture* TextureStreamer::open(const std::string& path, float priority) {
+	StreamedTexture* texture = new StreamedTexture();
+	texture->file = new Ktx2File(path);
+	texture->priority = priority;
+	Ktx2File* file = texture->file;
+	texture->residentLevel = file->levelCount;
+
+	// the tail is every level that fits in MIP_TAIL_SIZE, or at least the smallest one
+	texture->tailLevel = file->levelCount - 1;
+	while (texture->tailLevel > 0) {
+		VkExtent3D larger = file->extent(texture->tailLevel - 1);
+		if (std::max(larger.width, larger.height) > MIP_TAIL_SIZE)
+			break;
+		texture->tailLevel--;
+	}
+	texture->finestLevel = texture->tailLevel;
+	while (texture->finestLevel > 0 && file->levels[texture->finestLevel - 1].uncompressedByteLength <= maxUploadSize)
+		texture->finestLevel--;
+	texture->targetLevel = texture->tailLevel;
+
+	textures.push_back(texture);
+	if (file->isDecodable())
+		queueLoad(texture, texture->tailLevel);
+	else {
+		std::cerr << path << " is supercompressed with a scheme this build can't decode\n";
+		texture->failed = true;
+	}
+	return texture;
+}
+
+void TextureStreamer::close(StreamedTexture* texture, uint64_t retiredFrame) {
+	textures.erase(std::remove(textures.begin(), textures.end(), texture), textures.end());
+	residentBytes -= texture->bytesFrom(texture->residentLevel);
+	Retired resources;
+	resources.frame = retiredFrame;
+	resources.image = texture->image;
+	resources.view = texture->view;
+	resources.memory = texture->memory;
+	resources.bindlessIndex = texture->bindlessIndex;
+	// a load under way still points at the texture, it goes once the load has been retired too
+	if (!texture->loading)
+		resources.texture = texture;
+	else
+		texture->failed = true;
+	retire(resources);
+}
+
+void TextureStreamer::update(uint64_t currentFrame, uint64_t completedFrames) {
+	// images swapped out are destroyed once no frame in flight can sample them
+	while (!retired.empty() && completedFrames >= retired.front().frame) {
+		Retired& resources = retired.front();
+		vkDestroyImageView(renderer.device, resources.view, nullptr);
+		vkDestroyImage(renderer.device, resources.image, nullptr);
+		if (resources.memory.isValid())
+			renderer.allocator->free(resources.memory);
+		if (resources.texture != nullptr) {
+			delete resources.texture->file;
+			delete resources.texture;
+		}
+		retired.pop_front();
+	}
+
+	std::vector<Load> finished;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (size_t i = 0; i < uploading.size();) {
+			if (renderer.uploads->isComplete(uploading[i].token)) {
+				finished.push_back(uploading[i]);
+				uploading.erase(uploading.begin() + i);
+			}
+			else
+				i++;
+		}
+	}
+	for (auto& load : finished)
+		install(load, currentFrame);
+
+	assignTargets();
+	std::vector<StreamedTexture*> order(textures);
+	std::sort(order.begin(), order.end(), [](StreamedTexture* a, StreamedTexture* b) { return a->priority > b->priority; });
+	uint32_t loads = 0;
+	for (auto texture : order) {
+		if (texture->loading)
+			loads++;
+	}
+	// dropping levels frees memory for the rest, so it goes first and isn't held back by the load limit
+	for (auto it = order.rbegin(); it != order.rend(); it++) {
+		StreamedTexture* texture = *it;
+		if (!texture->loading && !texture->failed && texture->isReady() && texture->targetLevel > texture->residentLevel)
+			queueLoad(texture, texture->targetLevel);
+	}
+	// finer levels arrive one at a time, so every wanted texture improves a little before any is complete
+	for (auto texture : order) {
+		if (loads >= MAX_LOADS)
+			break;
+		if (!texture->loading && !texture->failed && texture->isReady() && texture->targetLevel < texture->residentLevel) {
+			queueLoad(texture, texture->residentLevel - 1);
+			loads++;
+		}
+	}
+}
+
+void TextureStreamer::clean() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (stopping)
+			return;
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+
+	// nothing is in flight, so everything can go at once, including closed textures only a load still held
+	for (auto& load : uploading)
+		queued.push_back(load);
+	uploading.clear();
+	for (auto& load : queued) {
+		Retired resources;
+		resources.image = load.image;
+		resources.view = load.view;
+		resources.memory = load.memory;
+		if (std::find(textures.begin(), textures.end(), load.texture) == textures.end())
+			resources.texture = load.texture;
+		load.texture->loading = false;
+		retire(resources);
+	}
+	queued.clear();
+	while (!textures.empty())
+		close(textures.back(), 0);
+	update(0, UINT64_MAX);
+	vkDestroySampler(renderer.device, sampler, nullptr);
+}
+
+void TextureStreamer::work() {
+	while (true) {
+		Load job;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this] { return stopping || !queued.empty(); });
+			if (stopping)
+				return;
+			job = queued.front();
+			queued.pop_front();
+		}
+
+		CpuZone loadZone(renderer.trace, "stream texture");
+		try {
+			load(job);
+		}
+		catch (const std::exception& e) {
+			// whatever was created is retired with the load, once its recorded uploads are done with it
+			std::cerr << "texture streaming: " << e.what() << '\n';
+			job.failed = true;
+		}
+		std::lock_guard<std::mutex> guard(lock);
+		uploading.push_back(job);
+	}
+}
+
+void TextureStreamer::load(Load& job) {
+	Ktx2File* file = job.texture->file;
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = file->format;
+	imageInfo.extent = file->extent(job.firstLevel);
+	imageInfo.mipLevels = file->levelCount - job.firstLevel;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(renderer.device, &imageInfo, nullptr, &job.image) != VK_SUCCESS)
+		throw std::runtime_error("failed to create streamed texture image");
+	job.memory = renderer.allocator->allocateImage(job.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	// reading a level faults its pages in from the mapping here, off the frame loop's thread
+	// the coarser levels are uploaded again with each finer one, at most a third more bytes than the new level,
+	// rather than sized for the whole chain up front, which would spend the memory the budget holds back
+	std::vector<char> scratch;
+	for (uint32_t level = file->levelCount; level-- > job.firstLevel;) {
+		size_t size = 0;
+		const char* data = file->levelData(level, scratch, size);
+		job.token = renderer.uploads->uploadImage(job.image, file->extent(level), level - job.firstLevel, data, size);
+	}
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = job.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = file->format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, imageInfo.mipLevels, 0, 1 };
+	if (vkCreateImageView(renderer.device, &viewInfo, nullptr, &job.view) != VK_SUCCESS)
+		throw std::runtime_error("failed to create streamed texture view");
+}
+
+void TextureStreamer::queueLoad(StreamedTexture* texture, uint32_t firstLevel) {
+	texture->loading = true;
+	Load job;
+	job.texture = texture;
+	job.firstLevel = firstLevel;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		queued.push_back(job);
+	}
+	wake.notify_one();
+}
+
+void TextureStreamer::install(Load& finished, uint64_t currentFrame) {
+	StreamedTexture* texture = finished.texture;
+	texture->loading = false;
+	Retired replaced;
+	replaced.frame = currentFrame;
+	// a failed or closed texture keeps nothing of the load
+	bool closed = std::find(textures.begin(), textures.end(), texture) == textures.end();
+	if (finished.failed || closed) {
+		replaced.image = finished.image;
+		replaced.view = finished.view;
+		replaced.memory = finished.memory;
+		if (closed)
+			replaced.texture = texture;
+		texture->failed = true;
+		retire(replaced);
+		return;
+	}
+
+	replaced.image = texture->image;
+	replaced.view = texture->view;
+	replaced.memory = texture->memory;
+	replaced.bindlessIndex = texture->bindlessIndex;
+	retire(replaced);
+
+	residentBytes -= texture->bytesFrom(texture->residentLevel);
+	residentBytes += texture->bytesFrom(finished.firstLevel);
+	loadedLevels += texture->file->levelCount - finished.firstLevel;
+	texture->image = finished.image;
+	texture->view = finished.view;
+	texture->memory = finished.memory;
+	texture->residentLevel = finished.firstLevel;
+	// a fresh index, the old one may still be read by frames in flight
+	if (renderer.bindless != nullptr)
+		texture->bindlessIndex = renderer.bindless->addTexture(texture->view, sampler);
+}
+
+void TextureStreamer::assignTargets() {
+	// every texture's tail stays resident whatever the budget
+	VkDeviceSize remaining = budget;
+	for (auto texture : textures)
+		remaining -= std::min(remaining, texture->bytesFrom(texture->tailLevel));
+
+	std::vector<StreamedTexture*> order(textures);
+	std::sort(order.begin(), order.end(), [](StreamedTexture* a, StreamedTexture* b) { return a->priority > b->priority; });
+	for (auto texture : order) {
+		uint32_t level = texture->tailLevel;
+		while (level > texture->finestLevel && texture->file->levels[level - 1].uncompressedByteLength <= remaining) {
+			level--;
+			remaining -= texture->file->levels[level].uncompressedByteLength;
+		}
+		texture->targetLevel = level;
+	}
+}
+
+void TextureStreamer::retire(Retired resources) {
+	if (resources.bindlessIndex != UINT32_MAX && renderer.bindless != nullptr)
+		renderer.bindless->releaseTexture(resources.bindlessIndex, resources.frame);
+	retired.push_back(resources);
+}
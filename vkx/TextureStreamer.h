@@ -0,0 +1,127 @@
+#ifndef TextureStreamer_h
+#define TextureStreamer_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Ktx2File.h"
+#include "MemoryAllocator.h"
+
+class Renderer;
+
+// a texture whose finer mips come and go with the residency budget
+// its image holds levels residentLevel and below, so the view, and the bindless index, change as levels arrive
+class StreamedTexture {
+public:
+	Ktx2File* file = nullptr;
+	// wanted levels go to the highest priorities first, such as the texture's size on screen
+	float priority = 1.0f;
+	// null until the mip tail has landed
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	// the view's slot in the renderer's bindless table, UINT32_MAX without one
+	uint32_t bindlessIndex = UINT32_MAX;
+	// finest level in the image, levelCount while nothing is resident
+	uint32_t residentLevel = 0;
+	// finest level the budget allows, streaming moves residentLevel towards it
+	uint32_t targetLevel = 0;
+	// coarsest levels loaded together when the texture is opened, all no larger than MIP_TAIL_SIZE
+	uint32_t tailLevel = 0;
+	// levels larger than the staging ring can't be uploaded and are never made resident
+	uint32_t finestLevel = 0;
+	bool loading = false;
+	// the file can't be decoded, the texture never becomes ready
+	bool failed = false;
+
+	bool isReady();
+	// bytes of the levels from level down
+	VkDeviceSize bytesFrom(uint32_t level);
+};
+
+// streams memory mapped KTX2 textures: the mip tail is uploaded first so something can be drawn at once,
+// finer levels follow as the residency budget allows, most wanted textures first
+// levels are decoded and copied to staging on worker threads, the frame loop only swaps finished images in
+// a texture changes level by loading a new image holding levels residentLevel and below, the old one is
+// destroyed once the frames that sampled it have finished
+class TextureStreamer {
+public:
+	// a mip tail level's largest side
+	static const uint32_t MIP_TAIL_SIZE = 64;
+	// loads queued or decoding at once, more would only hold up the finished ones
+	static const uint32_t MAX_LOADS = 4;
+	VkSampler sampler = VK_NULL_HANDLE;
+	// device local bytes the streamed levels may occupy, mip tails always stay resident
+	VkDeviceSize budget = 0;
+	VkDeviceSize residentBytes = 0;
+	uint64_t loadedLevels = 0;
+
+	TextureStreamer(Renderer& renderer, VkDeviceSize budget, uint32_t threadCount);
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	// maps the file and queues its mip tail, the texture stays owned by the streamer
+	// open, close and update are called from the frame loop's thread
+	StreamedTexture* open(const std::string& path, float priority = 1.0f);
+	// the texture may still be sampled by frames before retiredFrame, the renderer's currentFrame
+	void close(StreamedTexture* texture, uint64_t retiredFrame);
+	// swaps in finished loads, frees images no frame reads any more and queues the next loads
+	void update(uint64_t currentFrame, uint64_t completedFrames);
+	// stops the workers, the gpu must be idle
+	void clean();
+
+private:
+	// an image holding levels firstLevel and below, uploaded through the renderer's UploadService
+	class Load {
+	public:
+		StreamedTexture* texture = nullptr;
+		uint32_t firstLevel = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		MemoryAllocation memory;
+		// the last level's upload, the image is usable once it completes
+		uint64_t token = 0;
+		bool failed = false;
+	};
+
+	// resources no longer in use once every frame before the first has finished
+	class Retired {
+	public:
+		uint64_t frame = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		MemoryAllocation memory;
+		uint32_t bindlessIndex = UINT32_MAX;
+		StreamedTexture* texture = nullptr;
+	};
+
+	Renderer& renderer;
+	VkDeviceSize maxUploadSize = 0;
+	std::vector<StreamedTexture*> textures;
+	std::deque<Retired> retired;
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<Load> queued;
+	// loaded on a worker and waiting for their uploads
+	std::vector<Load> uploading;
+	bool stopping = false;
+
+	void work();
+	void load(Load& job);
+	void queueLoad(StreamedTexture* texture, uint32_t firstLevel);
+	void install(Load& finished, uint64_t currentFrame);
+	void assignTargets();
+	void retire(Retired resources);
+};
+
+#endif
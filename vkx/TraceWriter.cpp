@@ -0,0 +1,71 @@
+#include "TraceWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+
+TraceWriter::~TraceWriter() {
+	close();
+}
+
+void TraceWriter::open(const std::string& path) {
+	file.open(path, std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open file " + path);
+	// timestamps are written in microseconds with nanosecond resolution
+	file << std::fixed << std::setprecision(3);
+	// events are written as they finish, so a trace cut short by a crash still loads
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	firstEvent = true;
+	nameTrack(GPU_TRACK, "gpu");
+}
+
+bool TraceWriter::isOpen() {
+	return file.is_open();
+}
+
+void TraceWriter::complete(const std::string& name, const char* category, uint32_t track, uint64_t startNs, uint64_t durationNs) {
+	if (!file.is_open())
+		return;
+	std::lock_guard<std::mutex> guard(writeLock);
+	file << (firstEvent ? "\n" : ",\n");
+	firstEvent = false;
+	// chrome expects microseconds
+	file << "{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track
+		<< ",\"ts\":" << startNs / 1000.0 << ",\"dur\":" << durationNs / 1000.0 << "}";
+}
+
+void TraceWriter::close() {
+	if (!file.is_open())
+		return;
+	file << "\n]}\n";
+	file.close();
+}
+
+uint64_t TraceWriter::now() {
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// small stable id for the calling thread, the first thread to ask gets 1
+uint32_t TraceWriter::threadTrack() {
+	static std::atomic<uint32_t> nextTrack{ GPU_TRACK + 1 };
+	thread_local uint32_t track = nextTrack++;
+	return track;
+}
+
+void TraceWriter::nameTrack(uint32_t track, const std::string& name) {
+	file << (firstEvent ? "\n" : ",\n");
+	firstEvent = false;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":\"" << name << "\"}}";
+}
+
+CpuZone::CpuZone(TraceWriter& trace, const char* name) : trace(trace), name(name) {
+	start = TraceWriter::now();
+}
+
+CpuZone::~CpuZone() {
+	if (trace.isOpen())
+		trace.complete(name, "cpu", TraceWriter::threadTrack(), start, TraceWriter::now() - start);
+}
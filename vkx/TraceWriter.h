@@ -0,0 +1,44 @@
+#ifndef TraceWriter_h
+#define TraceWriter_h
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// streams timed zones to a json file that chrome://tracing and perfetto can open
+class TraceWriter {
+public:
+	// trace rows, cpu zones are shown per thread below the gpu row
+	static const uint32_t GPU_TRACK = 0;
+
+	~TraceWriter();
+	void open(const std::string& path);
+	bool isOpen();
+	// adds a finished zone, times are nanoseconds on the now() clock
+	void complete(const std::string& name, const char* category, uint32_t track, uint64_t startNs, uint64_t durationNs);
+	void close();
+	static uint64_t now();
+	static uint32_t threadTrack();
+
+private:
+	std::ofstream file;
+	std::mutex writeLock;
+	bool firstEvent = true;
+
+	void nameTrack(uint32_t track, const std::string& name);
+};
+
+// times the enclosing scope on the calling thread's row
+class CpuZone {
+public:
+	CpuZone(TraceWriter& trace, const char* name);
+	~CpuZone();
+
+private:
+	TraceWriter& trace;
+	const char* name;
+	uint64_t start;
+};
+
+#endif
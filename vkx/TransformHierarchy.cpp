@@ -0,0 +1,172 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+// column major, as the shaders read them, so out = a * b applies b first
+static void multiply(const DrawTransform& a, const DrawTransform& b, DrawTransform& out) {
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t row = 0; row < 4; row++) {
+			out.matrix[column * 4 + row] = a.matrix[row] * b.matrix[column * 4] + a.matrix[4 + row] * b.matrix[column * 4 + 1]
+				+ a.matrix[8 + row] * b.matrix[column * 4 + 2] + a.matrix[12 + row] * b.matrix[column * 4 + 3];
+		}
+	}
+}
+
+TransformHierarchy::TransformHierarchy(Renderer& renderer, uint32_t threadCount) : workers(std::max(threadCount, 1u)) {
+	device = renderer.device;
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	alignment = std::max<VkDeviceSize>(props.limits.minStorageBufferOffsetAlignment, 1);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	if (vkCreateDescriptorSetLayout(renderer.device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create transform descriptor set layout");
+}
+
+uint32_t TransformHierarchy::nodeCount() {
+	return (uint32_t)parent.size();
+}
+
+void TransformHierarchy::reserve(uint32_t count) {
+	parent.reserve(count);
+	local.reserve(count);
+	world.reserve(count);
+	dirty.reserve(count);
+	moved.reserve(count);
+	changed.reserve(count);
+}
+
+uint32_t TransformHierarchy::add(uint32_t parentNode, const DrawTransform& transform) {
+	uint32_t node = nodeCount();
+	uint32_t level = 0;
+	if (parentNode != ROOT) {
+		if (parentNode >= node)
+			throw std::runtime_error("failed to add transform node, its parent doesn't exist yet");
+		level = (uint32_t)(std::upper_bound(levelStart.begin(), levelStart.end(), parentNode) - levelStart.begin());
+	}
+	// a new level starts with its first node, adding to one above the last would break the order
+	if (level == levelStart.size())
+		levelStart.push_back(node);
+	else if (level + 1 != levelStart.size())
+		throw std::runtime_error("failed to add transform node, nodes must be added breadth first");
+
+	parent.push_back(parentNode);
+	local.push_back(transform);
+	world.push_back(transform);
+	dirty.push_back(1);
+	moved.push_back(0);
+	changed.push_back(0);
+	return node;
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const DrawTransform& transform) {
+	local[node] = transform;
+	dirty[node] = 1;
+}
+
+void TransformHierarchy::resize(Renderer& renderer, uint32_t slotCount) {
+	if (pool.buffer != VK_NULL_HANDLE)
+		pool.clean(renderer);
+	// whole regions keep every slot's descriptor offset aligned
+	VkDeviceSize range = std::max(nodeCount(), 1u) * sizeof(DrawTransform);
+	pool = LinearPool(renderer, (range + alignment - 1) / alignment * alignment, slotCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	// the new regions hold nothing yet, so the next update of each writes every node
+	slotWritten.assign(pool.frameCount, 0);
+}
+
+uint32_t TransformHierarchy::levelEnd(uint32_t level) {
+	return level + 1 < levelStart.size() ? levelStart[level + 1] : nodeCount();
+}
+
+// levels run one after another, within a level every node reads only its parent's finished world matrix
+void TransformHierarchy::update(uint64_t frame, DescriptorAllocator& descriptors) {
+	auto start = std::chrono::steady_clock::now();
+	uint64_t stamp = updates + 1;
+	uint32_t slot = (uint32_t)(frame % slotWritten.size());
+	uint64_t written = slotWritten[slot];
+	pool.beginFrame(frame);
+	matrices = pool.allocate(nodeCount() * sizeof(DrawTransform), alignment);
+	DrawTransform* out = static_cast<DrawTransform*>(matrices.mapped);
+
+	std::atomic<uint32_t> updated{ 0 };
+	for (uint32_t level = 0; level < levelStart.size(); level++) {
+		uint32_t begin = levelStart[level];
+		uint32_t end = levelEnd(level);
+		uint32_t tasks = std::clamp((end - begin) / MIN_NODES_PER_TASK, 1u, workers.workerCount() * TASKS_PER_WORKER);
+		// small levels, the top of every tree, aren't worth waking the workers for
+		if (tasks == 1) {
+			updated += updateRange(begin, end, stamp, written, out);
+			continue;
+		}
+		workers.run(tasks, [&](uint32_t task, uint32_t worker) {
+			uint32_t taskBegin = begin + (uint32_t)((uint64_t)(end - begin) * task / tasks);
+			uint32_t taskEnd = begin + (uint32_t)((uint64_t)(end - begin) * (task + 1) / tasks);
+			updated += updateRange(taskBegin, taskEnd, stamp, written, out);
+		});
+	}
+	slotWritten[slot] = stamp;
+	pool.flush();
+
+	// a set of the frame's own, released with the rest of the frame's sets once the slot comes around again
+	set = descriptors.allocate(layout);
+	VkDescriptorBufferInfo bufferInfo{ matrices.buffer, matrices.offset, matrices.size };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	updatedNodes = updated;
+	lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	totalUpdateMs += lastUpdateMs;
+	updates++;
+}
+
+uint32_t TransformHierarchy::updateRange(uint32_t begin, uint32_t end, uint64_t stamp, uint64_t written, DrawTransform* out) {
+	uint32_t count = 0;
+	for (uint32_t node = begin; node < end; node++) {
+		uint32_t parentNode = parent[node];
+		bool moves = dirty[node] != 0 || (parentNode != ROOT && moved[parentNode] != 0);
+		moved[node] = moves ? 1 : 0;
+		if (moves) {
+			dirty[node] = 0;
+			if (parentNode == ROOT)
+				world[node] = local[node];
+			else
+				multiply(world[parentNode], local[node], world[node]);
+			changed[node] = stamp;
+			count++;
+		}
+		// the slot's copy is stale if the matrix changed since the slot was last written, this update included
+		if (changed[node] > written)
+			out[node] = world[node];
+	}
+	return count;
+}
+
+void TransformHierarchy::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) {
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1, &set, 0, nullptr);
+}
+
+void TransformHierarchy::clean(Renderer& renderer) {
+	if (pool.buffer != VK_NULL_HANDLE)
+		pool.clean(renderer);
+	pool = LinearPool();
+	vkDestroyDescriptorSetLayout(renderer.device, layout, nullptr);
+}
@@ -0,0 +1,87 @@
+#ifndef TransformHierarchy_h
+#define TransformHierarchy_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+#include "LinearPool.h"
+#include "SceneStore.h"
+#include "WorkerPool.h"
+
+class Renderer;
+
+// parent and child transforms as flat arrays in breadth-first order, so every parent comes before its children
+// and a level's nodes only read the level above, letting each level be updated in parallel
+// only subtrees under a changed local transform are recomputed, and a frame slot's region of the
+// gpu buffer is only rewritten where world matrices changed since that slot was last written
+// each frame's region is read through a set allocated from that frame's DescriptorAllocator
+class TransformHierarchy {
+public:
+	// parent of the roots
+	static const uint32_t ROOT = UINT32_MAX;
+	// fewer nodes than this per task cost more to hand out than they save
+	static const uint32_t MIN_NODES_PER_TASK = 4096;
+	// tasks per worker, so threads that finish early can take over another's work
+	static const uint32_t TASKS_PER_WORKER = 4;
+	std::vector<uint32_t> parent;
+	std::vector<DrawTransform> local;
+	std::vector<DrawTransform> world;
+	// first node of each level
+	std::vector<uint32_t> levelStart;
+	// a region of world matrices per frame in flight, indexed by node
+	LinearPool pool;
+	// this frame's region, valid after update
+	LinearAllocation matrices;
+	// set 1 of every pipeline layout while there is a hierarchy, see shaders/transform.vert
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	// this frame's set, pointing at matrices, valid after update
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// minStorageBufferOffsetAlignment, every region starts on a multiple of it
+	VkDeviceSize alignment = 1;
+	// nodes recomputed by the last update, and cpu time of the last update and of every update so far
+	uint32_t updatedNodes = 0;
+	double lastUpdateMs = 0;
+	double totalUpdateMs = 0;
+	uint64_t updates = 0;
+
+	// updates on this many threads, the calling thread included
+	TransformHierarchy(Renderer& renderer, uint32_t threadCount);
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+	uint32_t nodeCount();
+	void reserve(uint32_t count);
+	// nodes must be added level by level, a node's parent added before it, returns the node's index
+	uint32_t add(uint32_t parentNode, const DrawTransform& transform);
+	// dirties the node's subtree for the next update
+	void setLocal(uint32_t node, const DrawTransform& transform);
+	// creates the gpu buffer once every node is added, the gpu must be idle
+	void resize(Renderer& renderer, uint32_t slotCount);
+	// only call once the gpu has finished the frame that last used this frame's slot,
+	// descriptors is that slot's allocator, already reset
+	void update(uint64_t frame, DescriptorAllocator& descriptors);
+	// binds this frame's matrices, after update
+	void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex);
+	void clean(Renderer& renderer);
+
+private:
+	WorkerPool workers;
+	VkDevice device = VK_NULL_HANDLE;
+	// local transform changed since the last update
+	std::vector<uint8_t> dirty;
+	// world matrix recomputed by the current update, which dirties the node's children
+	std::vector<uint8_t> moved;
+	// update the world matrix last changed in, counted from 1
+	std::vector<uint64_t> changed;
+	// update each slot's region was last written in, 0 when it never was
+	std::vector<uint64_t> slotWritten;
+
+	uint32_t levelEnd(uint32_t level);
+	// returns how many of the nodes were recomputed
+	uint32_t updateRange(uint32_t begin, uint32_t end, uint64_t stamp, uint64_t written, DrawTransform* out);
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+UniformRing::UniformRing() {}
+
+UniformRing::UniformRing(Renderer& renderer, VkDeviceSize frameSize, uint32_t frameCount) {
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 1);
+	// whole regions keep every frame's first offset aligned
+	frameSize = (std::max(frameSize, BLOCK_RANGE) + alignment - 1) / alignment * alignment;
+	pool = LinearPool(renderer, frameSize, frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	if (vkCreateDescriptorSetLayout(renderer.device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create uniform ring descriptor set layout");
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(renderer.device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create uniform ring descriptor pool");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+	if (vkAllocateDescriptorSets(renderer.device, &allocInfo, &set) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate uniform ring descriptor set");
+
+	// written once, every frame and every block is reached through the dynamic offset alone
+	VkDescriptorBufferInfo bufferInfo{ pool.buffer, 0, BLOCK_RANGE };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(renderer.device, 1, &write, 0, nullptr);
+}
+
+void UniformRing::beginFrame(uint64_t frame) {
+	pool.beginFrame(frame);
+}
+
+uint32_t UniformRing::write(const void* data, VkDeviceSize size) {
+	if (size > BLOCK_RANGE)
+		throw std::runtime_error("uniform block is larger than the ring's range");
+	// the descriptor always reads BLOCK_RANGE bytes, so that much must lie inside the region
+	LinearAllocation allocation = pool.allocate(BLOCK_RANGE, alignment);
+	if (allocation.buffer == VK_NULL_HANDLE)
+		throw std::runtime_error("uniform ring is full for this frame");
+	memcpy(allocation.mapped, data, (size_t)size);
+	return (uint32_t)allocation.offset;
+}
+
+LinearAllocation UniformRing::allocateArray(uint32_t count, VkDeviceSize size) {
+	if (size > BLOCK_RANGE || count == 0)
+		return LinearAllocation();
+	// the last block's window has to fit too, not just its data
+	return pool.allocate((count - 1) * stride(size) + BLOCK_RANGE, alignment);
+}
+
+VkDeviceSize UniformRing::stride(VkDeviceSize size) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+void UniformRing::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex, uint32_t offset, VkPipelineBindPoint bindPoint) {
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &set, 1, &offset);
+}
+
+void UniformRing::flush() {
+	pool.flush();
+}
+
+void UniformRing::clean(Renderer& renderer) {
+	vkDestroyDescriptorPool(renderer.device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(renderer.device, layout, nullptr);
+	pool.clean(renderer);
+}
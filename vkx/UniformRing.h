@@ -0,0 +1,45 @@
+#ifndef UniformRing_h
+#define UniformRing_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "LinearPool.h"
+
+class Renderer;
+
+// per frame uniform data written straight into a persistently mapped LinearPool and read through a single
+// UNIFORM_BUFFER_DYNAMIC descriptor, so an update is a memcpy and a bind only moves the dynamic offset
+// a frame slot's region is reused once the gate that last rendered from it has signalled
+class UniformRing {
+public:
+	// bytes a shader can read past one dynamic offset, a block can't be larger
+	static const VkDeviceSize BLOCK_RANGE = 256;
+	LinearPool pool;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// minUniformBufferOffsetAlignment, every dynamic offset is a multiple of it
+	VkDeviceSize alignment = 1;
+
+	UniformRing();
+	UniformRing(Renderer& renderer, VkDeviceSize frameSize, uint32_t frameCount);
+	// only call once the gate that last used the frame's slot has signalled
+	void beginFrame(uint64_t frame);
+	// copies a block into this frame's region and returns the dynamic offset to bind it at
+	uint32_t write(const void* data, VkDeviceSize size);
+	// reserves count blocks of size bytes, stride(size) apart, to be filled in place through mapped
+	// a null buffer means the frame's region is full
+	LinearAllocation allocateArray(uint32_t count, VkDeviceSize size);
+	// distance between consecutive blocks of an array
+	VkDeviceSize stride(VkDeviceSize size);
+	void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex, uint32_t offset,
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+	// makes this frame's writes visible to the gpu, call before submitting
+	void flush();
+	void clean(Renderer& renderer);
+
+private:
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+};
+
+#endif
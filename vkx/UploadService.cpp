@@ -0,0 +1,366 @@
+#include "UploadService.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Renderer.h"
+
+UploadService::UploadService(Renderer& renderer) {
+	device = renderer.device;
+	allocator = renderer.allocator;
+	graphicsQueue = renderer.graphicsQueue;
+	transferQueue = renderer.transferQueue;
+	transferLock = &renderer.queueLock(transferQueue);
+	graphicsLock = &renderer.queueLock(graphicsQueue);
+	graphicsFamily = renderer.indices.graphicsFamily.value();
+	dedicatedQueue = renderer.indices.transferFamily.has_value();
+	transferFamily = dedicatedQueue ? renderer.indices.transferFamily.value() : graphicsFamily;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &props);
+	// copies into images need offsets that are a multiple of 4 and of the texel size, 16 covers every color format
+	copyAlignment = std::max<VkDeviceSize>(16, props.limits.optimalBufferCopyOffsetAlignment);
+
+	stagingSize = renderer.settings.stagingSize;
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = stagingSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &staging) != VK_SUCCESS)
+		throw std::runtime_error("failed to create staging buffer");
+	stagingMemory = allocator->allocateBuffer(staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = transferFamily;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create upload command pool");
+	if (dedicatedQueue) {
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &acquirePool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create upload command pool");
+	}
+
+	timeline = renderer.timelineSemaphores;
+	if (timeline) {
+		waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+		getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+		VkSemaphoreTypeCreateInfoKHR typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &counter) != VK_SUCCESS ||
+			(dedicatedQueue && vkCreateSemaphore(device, &semaphoreInfo, nullptr, &transferCounter) != VK_SUCCESS))
+			throw std::runtime_error("failed to create upload timeline semaphore");
+	}
+
+	batches.resize(MAX_BATCHES);
+	for (auto& batch : batches) {
+		batch.transfer = allocateCommandBuffer(transferPool);
+		if (dedicatedQueue)
+			batch.acquire = allocateCommandBuffer(acquirePool);
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if ((!timeline && dedicatedQueue && vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.handoff) != VK_SUCCESS) ||
+			(!timeline && vkCreateFence(device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)) {
+			throw std::runtime_error("failed to create upload batch");
+		}
+	}
+}
+
+uint64_t UploadService::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, bool concurrent) {
+	std::lock_guard<std::mutex> guard(uploadLock);
+	VkDeviceSize stagingOffset = reserveStaging(size);
+	memcpy(static_cast<char*>(stagingMemory.mapped) + stagingOffset, data, (size_t)size);
+	UploadBatch& batch = openBatch();
+
+	VkBufferCopy copy{};
+	copy.srcOffset = stagingOffset;
+	copy.dstOffset = offset;
+	copy.size = size;
+	vkCmdCopyBuffer(batch.transfer, staging, buffer, 1, &copy);
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	bool transferOwnership = dedicatedQueue && !concurrent;
+	barrier.srcQueueFamilyIndex = transferOwnership ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = transferOwnership ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	if (transferOwnership) {
+		// release on the transfer queue, then acquire on the graphics queue with an identical barrier
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(batch.acquire, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+	else
+		vkCmdPipelineBarrier(batch.transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	uploadedBytes += size;
+	return batch.token;
+}
+
+uint64_t UploadService::uploadImage(VkImage image, VkExtent3D extent, uint32_t mipLevel, const void* data, VkDeviceSize size, VkImageLayout finalLayout) {
+	std::lock_guard<std::mutex> guard(uploadLock);
+	VkDeviceSize stagingOffset = reserveStaging(size);
+	memcpy(static_cast<char*>(stagingMemory.mapped) + stagingOffset, data, (size_t)size);
+	UploadBatch& batch = openBatch();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+	// previous contents of the level are discarded
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.transfer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy copy{};
+	copy.bufferOffset = stagingOffset;
+	copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 };
+	copy.imageExtent = extent;
+	vkCmdCopyBufferToImage(batch.transfer, staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+	// the layout transition happens once, as part of the release and acquire pair when the queues differ
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	if (dedicatedQueue) {
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(batch.transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(batch.acquire, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+	else
+		vkCmdPipelineBarrier(batch.transfer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	uploadedBytes += size;
+	return batch.token;
+}
+
+void UploadService::flush() {
+	std::lock_guard<std::mutex> guard(uploadLock);
+	retire(false);
+	if (recording != nullptr)
+		submit();
+}
+
+bool UploadService::isComplete(uint64_t token) {
+	std::lock_guard<std::mutex> guard(uploadLock);
+	if (token > completedToken)
+		retire(false);
+	return token <= completedToken;
+}
+
+// waits for an upload, flushing it first if it hasn't been submitted yet
+void UploadService::wait(uint64_t token) {
+	std::lock_guard<std::mutex> guard(uploadLock);
+	if (recording != nullptr && token >= recording->token)
+		submit();
+	while (token > completedToken && !inFlight.empty())
+		retire(true);
+}
+
+void UploadService::clean() {
+	for (auto& batch : batches) {
+		if (batch.pending && batch.fence != VK_NULL_HANDLE)
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		vkDestroySemaphore(device, batch.handoff, nullptr);
+		vkDestroyFence(device, batch.fence, nullptr);
+	}
+	vkDestroySemaphore(device, counter, nullptr);
+	vkDestroySemaphore(device, transferCounter, nullptr);
+	vkDestroyCommandPool(device, transferPool, nullptr);
+	vkDestroyCommandPool(device, acquirePool, nullptr);
+	vkDestroyBuffer(device, staging, nullptr);
+	allocator->free(stagingMemory);
+}
+
+VkDeviceSize UploadService::reserveStaging(VkDeviceSize size) {
+	if (size + copyAlignment > stagingSize)
+		throw std::runtime_error("upload is larger than the staging ring");
+	VkDeviceSize offset;
+	while (!tryReserve(size, offset)) {
+		// the ring is full, push out what's recorded and wait for the oldest batch to free its space
+		if (recording != nullptr)
+			submit();
+		retire(true);
+	}
+	return offset;
+}
+
+bool UploadService::tryReserve(VkDeviceSize size, VkDeviceSize& offset) {
+	if (head == tail && inFlight.empty() && recording == nullptr)
+		head = tail = 0;
+	offset = (head + copyAlignment - 1) / copyAlignment * copyAlignment;
+	if (head >= tail) {
+		// free space is the end of the ring and then its start, an allocation can't end exactly at tail or the ring would look empty
+		if (offset + size <= stagingSize) {
+			head = offset + size;
+			return true;
+		}
+		if (size < tail) {
+			offset = 0;
+			head = size;
+			return true;
+		}
+		return false;
+	}
+	if (offset + size < tail) {
+		head = offset + size;
+		return true;
+	}
+	return false;
+}
+
+UploadBatch& UploadService::openBatch() {
+	if (recording != nullptr)
+		return *recording;
+	UploadBatch& batch = batches[nextBatch];
+	// every batch is busy, wait for the oldest
+	while (batch.pending)
+		retire(true);
+	nextBatch = (nextBatch + 1) % MAX_BATCHES;
+
+	batch.token = nextToken++;
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.transfer, &beginInfo);
+	if (dedicatedQueue)
+		vkBeginCommandBuffer(batch.acquire, &beginInfo);
+	recording = &batch;
+	return batch;
+}
+
+void UploadService::submit() {
+	UploadBatch& batch = *recording;
+	recording = nullptr;
+	batch.stagingEnd = head;
+	vkEndCommandBuffer(batch.transfer);
+	if (dedicatedQueue)
+		vkEndCommandBuffer(batch.acquire);
+	if (batch.fence != VK_NULL_HANDLE)
+		vkResetFences(device, 1, &batch.fence);
+
+	// with timeline semaphores each submit signals the batch's token, the transfer on its own semaphore when
+	// an acquire follows on the graphics queue, otherwise straight on the counter
+	uint64_t value = batch.token;
+	VkTimelineSemaphoreSubmitInfoKHR transferTimeline{};
+	transferTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	transferTimeline.signalSemaphoreValueCount = 1;
+	transferTimeline.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo transferSubmit{};
+	transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	transferSubmit.commandBufferCount = 1;
+	transferSubmit.pCommandBuffers = &batch.transfer;
+	if (timeline) {
+		transferSubmit.pNext = &transferTimeline;
+		transferSubmit.signalSemaphoreCount = 1;
+		transferSubmit.pSignalSemaphores = dedicatedQueue ? &transferCounter : &counter;
+	}
+	else if (dedicatedQueue) {
+		transferSubmit.signalSemaphoreCount = 1;
+		transferSubmit.pSignalSemaphores = &batch.handoff;
+	}
+	{
+		std::lock_guard<std::mutex> guard(*transferLock);
+		if (vkQueueSubmit(transferQueue, 1, &transferSubmit, dedicatedQueue ? VK_NULL_HANDLE : batch.fence) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit uploads");
+	}
+
+	if (dedicatedQueue) {
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkTimelineSemaphoreSubmitInfoKHR acquireTimeline{};
+		acquireTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		acquireTimeline.waitSemaphoreValueCount = 1;
+		acquireTimeline.pWaitSemaphoreValues = &value;
+		acquireTimeline.signalSemaphoreValueCount = 1;
+		acquireTimeline.pSignalSemaphoreValues = &value;
+
+		// submitted ahead of the frame on the graphics queue, so the frame sees the acquired resources
+		VkSubmitInfo acquireSubmit{};
+		acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmit.waitSemaphoreCount = 1;
+		acquireSubmit.pWaitSemaphores = timeline ? &transferCounter : &batch.handoff;
+		acquireSubmit.pWaitDstStageMask = &waitStage;
+		acquireSubmit.commandBufferCount = 1;
+		acquireSubmit.pCommandBuffers = &batch.acquire;
+		if (timeline) {
+			acquireSubmit.pNext = &acquireTimeline;
+			acquireSubmit.signalSemaphoreCount = 1;
+			acquireSubmit.pSignalSemaphores = &counter;
+		}
+		std::lock_guard<std::mutex> guard(*graphicsLock);
+		if (vkQueueSubmit(graphicsQueue, 1, &acquireSubmit, batch.fence) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit upload ownership transfer");
+	}
+	batch.pending = true;
+	inFlight.push_back((uint32_t)(&batch - batches.data()));
+}
+
+// moves finished batches out of flight and frees their staging space, optionally blocking on the oldest
+void UploadService::retire(bool block) {
+	while (!inFlight.empty()) {
+		UploadBatch& batch = batches[inFlight.front()];
+		bool finished;
+		if (timeline) {
+			// the acquire's value, reached once the batch is usable on the graphics queue
+			uint64_t value = batch.token;
+			if (block) {
+				VkSemaphoreWaitInfoKHR waitInfo{};
+				waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+				waitInfo.semaphoreCount = 1;
+				waitInfo.pSemaphores = &counter;
+				waitInfo.pValues = &value;
+				waitSemaphores(device, &waitInfo, UINT64_MAX);
+			}
+			uint64_t reached = 0;
+			getCounterValue(device, counter, &reached);
+			finished = reached >= value;
+		}
+		else {
+			if (block)
+				vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+			finished = vkGetFenceStatus(device, batch.fence) == VK_SUCCESS;
+		}
+		if (!finished)
+			return;
+		batch.pending = false;
+		tail = batch.stagingEnd;
+		completedToken = batch.token;
+		inFlight.pop_front();
+		block = false;
+	}
+}
+
+VkCommandBuffer UploadService::allocateCommandBuffer(VkCommandPool pool) {
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate upload command buffer");
+	return commandBuffer;
+}
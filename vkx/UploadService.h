@@ -0,0 +1,98 @@
+#ifndef UploadService_h
+#define UploadService_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+class Renderer;
+
+// uploads recorded between two flushes, submitted together
+class UploadBatch {
+public:
+	VkCommandBuffer transfer = VK_NULL_HANDLE;
+	// records the graphics queue's half of each ownership transfer
+	VkCommandBuffer acquire = VK_NULL_HANDLE;
+	// without timeline semaphores, links the two submits and marks the batch finished
+	VkSemaphore handoff = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	uint64_t token = 0;
+	// where the staging ring's tail moves once this batch is finished
+	VkDeviceSize stagingEnd = 0;
+	bool pending = false;
+};
+
+// copies buffers and images to device local memory through a persistently mapped staging ring
+// uploads go out on a transfer-only queue when the device has one, so they overlap with rendering
+// every upload returns a token, which completes once the data is usable on the graphics queue
+class UploadService {
+public:
+	VkBuffer staging = VK_NULL_HANDLE;
+	MemoryAllocation stagingMemory;
+	VkDeviceSize stagingSize = 0;
+	// true when uploads run on their own queue family and need ownership transfers
+	bool dedicatedQueue = false;
+	uint64_t uploadedBytes = 0;
+
+	UploadService(Renderer& renderer);
+	// concurrent buffers are shared between queue families and skip the ownership transfer
+	uint64_t uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, bool concurrent = false);
+	// writes one mip level of a color image and leaves it in finalLayout
+	uint64_t uploadImage(VkImage image, VkExtent3D extent, uint32_t mipLevel, const void* data, VkDeviceSize size,
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// submits everything recorded since the last flush, called once per frame before the frame's own submit
+	void flush();
+	bool isComplete(uint64_t token);
+	void wait(uint64_t token);
+	void clean();
+
+private:
+	static const uint32_t MAX_BATCHES = 8;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	// held around each submit, the frame submits to the graphics queue from its own thread
+	std::mutex* transferLock = nullptr;
+	std::mutex* graphicsLock = nullptr;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool acquirePool = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+	VkDeviceSize copyAlignment = 16;
+
+	bool timeline = false;
+	// signalled to a batch's token once its uploads are usable on the graphics queue
+	VkSemaphore counter = VK_NULL_HANDLE;
+	// with a dedicated queue, signalled to the token by the transfer submit that the acquire waits on
+	// the two queues never signal the same semaphore, which they could do out of order
+	VkSemaphore transferCounter = VK_NULL_HANDLE;
+	PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR getCounterValue = nullptr;
+
+	std::vector<UploadBatch> batches;
+	// pending batches in submission order, by index into batches
+	std::deque<uint32_t> inFlight;
+	UploadBatch* recording = nullptr;
+	uint32_t nextBatch = 0;
+	uint64_t nextToken = 1;
+	uint64_t completedToken = 0;
+	// staging bytes in use run from tail up to head, wrapping at the end, and tail == head when empty
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+	std::mutex uploadLock;
+
+	VkDeviceSize reserveStaging(VkDeviceSize size);
+	bool tryReserve(VkDeviceSize size, VkDeviceSize& offset);
+	UploadBatch& openBatch();
+	void submit();
+	void retire(bool block);
+	VkCommandBuffer allocateCommandBuffer(VkCommandPool pool);
+};
+
+#endif
@@ -1,32 +1,46 @@
 #include "Window.h"
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
 #include <stdexcept>
 
 #include "Renderer.h"
 
-class Window {
-public:
-	// default window size of 720p
-	const uint32_t DEFAULT_WINDOW_WIDTH = 1280;
-	const uint32_t DEFAULT_WINDOW_HEIGHT = 720;
-
-	GLFWwindow* window;
-	VkSurfaceKHR surface;
-
-	Window(Renderer* renderer) {
-		// create glfw window
-		glfwInit();
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
-		window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "Renderer", nullptr, nullptr);
-
-		// link glfw to vulkan
-		if (glfwCreateWindowSurface(renderer->instance, window, nullptr, &surface) != VK_SUCCESS) {
-			throw std::runtime_error("failed to link vulkan to glfw");
-		}
+// an absent window, used when rendering headless
+Window::Window() {}
+
+Window::Window(Renderer* renderer) {
+	// create glfw window
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+	window = glfwCreateWindow(renderer->settings.width, renderer->settings.height, "Renderer", nullptr, nullptr);
+	// Window is copied into its Renderer, so the callback finds it through the renderer
+	glfwSetWindowUserPointer(window, renderer);
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
+		static_cast<Renderer*>(glfwGetWindowUserPointer(window))->window.framebufferResized = true;
+	});
+	// every kind of input starts a latency measurement, when latency is being measured
+	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+		inputReceived(window);
+	});
+	glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+		inputReceived(window);
+	});
+	glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y) {
+		inputReceived(window);
+	});
+	glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y) {
+		inputReceived(window);
+	});
+}
+
+void Window::inputReceived(GLFWwindow* window) {
+	LatencyTracker* latency = static_cast<Renderer*>(glfwGetWindowUserPointer(window))->latency;
+	if (latency != nullptr)
+		latency->input();
+}
+
+void Window::createSurface(Renderer* renderer) {
+	// link glfw to vulkan
+	if (glfwCreateWindowSurface(renderer->instance, window, nullptr, &surface) != VK_SUCCESS) {
+		throw std::runtime_error("failed to link vulkan to glfw");
 	}
-
-};
+}
@@ -1,13 +1,25 @@
 #ifndef Window_h
 #define Window_h
 
-#include "Renderer.h"
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+class Renderer;
 
 class Window {
 public:
-	GLFWwindow* window;
-	VkSurfaceKHR surface;
+	GLFWwindow* window = nullptr;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	// set by glfw when the framebuffer changes size, cleared once the target is rebuilt
+	bool framebufferResized = false;
+	Window();
+	// opens the window, glfw must have been initialised on this thread
 	Window(Renderer* renderer);
+	// the surface needs the renderer's instance, which may be created while the window opens
+	void createSurface(Renderer* renderer);
+
+private:
+	static void inputReceived(GLFWwindow* window);
 };
 
 #endif
@@ -0,0 +1,76 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t workerCount) {
+	for (uint32_t i = 1; i < std::max(workerCount, 1u); i++)
+		threads.emplace_back(&WorkerPool::work, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+uint32_t WorkerPool::workerCount() {
+	return (uint32_t)threads.size() + 1;
+}
+
+void WorkerPool::run(uint32_t count, const std::function<void(uint32_t, uint32_t)>& task) {
+	if (count == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		current = &task;
+		taskCount = count;
+		nextTask = 0;
+		failure = nullptr;
+		busyWorkers = (uint32_t)threads.size();
+		generation++;
+	}
+	wake.notify_all();
+	drain(0);
+
+	std::unique_lock<std::mutex> guard(lock);
+	done.wait(guard, [this] { return busyWorkers == 0; });
+	current = nullptr;
+	if (failure)
+		std::rethrow_exception(failure);
+}
+
+void WorkerPool::work(uint32_t workerIndex) {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+		drain(workerIndex);
+		std::lock_guard<std::mutex> guard(lock);
+		if (--busyWorkers == 0)
+			done.notify_one();
+	}
+}
+
+// takes tasks until none are left, later tasks are skipped once one has failed
+void WorkerPool::drain(uint32_t workerIndex) {
+	for (uint32_t task = nextTask++; task < taskCount; task = nextTask++) {
+		try {
+			(*current)(task, workerIndex);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (!failure)
+				failure = std::current_exception();
+			nextTask = taskCount;
+		}
+	}
+}
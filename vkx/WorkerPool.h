@@ -0,0 +1,44 @@
+#ifndef WorkerPool_h
+#define WorkerPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of threads that run batches of numbered tasks
+// the calling thread joins in as worker 0, so a pool of one worker runs everything inline
+class WorkerPool {
+public:
+	WorkerPool(uint32_t workerCount);
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	uint32_t workerCount();
+	// calls task(taskIndex, workerIndex) for every index below taskCount and returns once all have finished
+	// the first exception thrown by a task is rethrown here
+	void run(uint32_t taskCount, const std::function<void(uint32_t, uint32_t)>& task);
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(uint32_t, uint32_t)>* current = nullptr;
+	uint32_t taskCount = 0;
+	std::atomic<uint32_t> nextTask{ 0 };
+	// bumped for every batch so sleeping workers can tell a new one has started
+	uint64_t generation = 0;
+	uint32_t busyWorkers = 0;
+	std::exception_ptr failure;
+	bool stopping = false;
+
+	void work(uint32_t workerIndex);
+	void drain(uint32_t workerIndex);
+};
+
+#endif
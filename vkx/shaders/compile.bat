@@ -1,3 +1,12 @@
 glslc shader.vert -o vert.spv
 glslc shader.frag -o frag.spv
+glslc bench.vert -o bench.spv
+glslc mesh.vert -o mesh.spv
+glslc transform.vert -o transform.spv
+glslc meshtransform.vert -o meshtransform.spv
+glslc drawuniform.vert -o drawuniform.spv
+glslc meshdrawuniform.vert -o meshdrawuniform.spv
+glslc drawpush.vert -o drawpush.spv
+glslc meshdrawpush.vert -o meshdrawpush.spv
+glslc cull.comp -o cull.spv
 pause
\ No newline at end of file
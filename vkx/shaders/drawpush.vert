@@ -0,0 +1,34 @@
+#version 450
+
+// triangles per row and column of the grid that instances are laid out on
+layout(constant_id = 0) const uint GRID_SIDE = 1;
+
+// the draw's DrawTransform, pushed at the start of the range
+layout(push_constant) uniform Draw {
+    mat4 transform;
+} draw;
+
+vec3 colors[3] = vec3[](
+    vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0)
+    );
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+    );
+
+layout(location = 0) out vec3 fragColor;
+// the depth prepass runs this shader in another pipeline, its depths have to match to the bit
+invariant gl_Position;
+
+void main() {
+    // each instance is one triangle shrunk into its own grid cell, then moved with its object
+    float cell = 2.0 / float(GRID_SIDE);
+    uint index = uint(gl_InstanceIndex);
+    vec2 origin = vec2(float(index % GRID_SIDE), float((index / GRID_SIDE) % GRID_SIDE)) * cell - 1.0 + cell * 0.5;
+    gl_Position = draw.transform * vec4(origin + positions[gl_VertexIndex] * cell, 0.0, 1.0);
+    fragColor = colors[gl_VertexIndex];
+}
@@ -0,0 +1,26 @@
+#version 450
+
+// triangles per row and column of the grid that instances are laid out on
+layout(constant_id = 0) const uint GRID_SIDE = 1;
+
+// the draw's DrawTransform, pushed at the start of the range
+layout(push_constant) uniform Draw {
+    mat4 transform;
+} draw;
+
+// MeshVertex, the unit square around the origin fills one grid cell
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+// the depth prepass runs this shader in another pipeline, its depths have to match to the bit
+invariant gl_Position;
+
+void main() {
+    // each instance is one copy of the mesh shrunk into its own grid cell, then moved with its object
+    float cell = 2.0 / float(GRID_SIDE);
+    uint index = uint(gl_InstanceIndex);
+    vec2 origin = vec2(float(index % GRID_SIDE), float((index / GRID_SIDE) % GRID_SIDE)) * cell - 1.0 + cell * 0.5;
+    gl_Position = draw.transform * vec4(origin + inPosition.xy * cell, clamp(inPosition.z + 0.5, 0.0, 1.0), 1.0);
+    fragColor = inColor;
+}
@@ -0,0 +1,31 @@
+#version 450
+
+// triangles per row and column of the grid that instances are laid out on
+layout(constant_id = 0) const uint GRID_SIDE = 1;
+
+// TransformHierarchy's world matrices for this frame, node i is the scene's object i
+layout(set = 1, binding = 0) readonly buffer WorldMatrices {
+    mat4 world[];
+};
+
+// the object being drawn, pushed at LayoutBundle::OBJECT_INDEX_OFFSET
+layout(push_constant) uniform Draw {
+    layout(offset = 64) uint object;
+} draw;
+
+// MeshVertex, the unit square around the origin fills one grid cell
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+// the depth prepass runs this shader in another pipeline, its depths have to match to the bit
+invariant gl_Position;
+
+void main() {
+    // each instance is one copy of the mesh shrunk into its own grid cell, then moved with its object
+    float cell = 2.0 / float(GRID_SIDE);
+    uint index = uint(gl_InstanceIndex);
+    vec2 origin = vec2(float(index % GRID_SIDE), float((index / GRID_SIDE) % GRID_SIDE)) * cell - 1.0 + cell * 0.5;
+    gl_Position = world[draw.object] * vec4(origin + inPosition.xy * cell, clamp(inPosition.z + 0.5, 0.0, 1.0), 1.0);
+    fragColor = inColor;
+}